@@ -2,6 +2,7 @@
 
 #include "hal_platform.h"
 #include "FreeRTOS_Support.h"
+#include "FreeRTOS_Trace.h"
 #include "hal_memory.h"
 #include "hal_nvic.h"
 #include "hal_stdio.h"
@@ -11,13 +12,24 @@
 #include "errors_events.h"
 #include "utilitiesX.h"
 
+#include "esp_attr.h"
 #include "esp_debug_helpers.h"
+#include "esp_freertos_hooks.h"
+#include "esp_heap_caps.h"
+#if defined(CONFIG_HEAP_TASK_TRACKING)
+	#include "esp_heap_task_info.h"
+#endif
 
 #if (halUSE_BSP == 1 && cmakeGUI == 4)
     #include "gui_main.hpp"
 #endif
+#include <stdarg.h>
+#include <stddef.h>
+#include <stdio.h>
 #include <string.h>
 
+#include "freertos/task_snapshot.h"
+
 // ########################################### Macros ##############################################
 
 #define	debugFLAG					0xF000
@@ -30,113 +42,1127 @@
 #define SP							RP
 #define IF_SP						IF_RP
 
+#if defined(CONFIG_IDF_TARGET_ARCH_XTENSA)				// strip window bits, point at CALLx instruction
+	#define rtosCALLER_PC(pc)		((((u32_t) (uintptr_t) (pc) & 0x3FFFFFFFUL) | 0x40000000UL) - 3)
+#else
+	#define rtosCALLER_PC(pc)		((u32_t) (uintptr_t) (pc) - 4)
+#endif
+
+/* On interrupt entry (not nested) the port saves the interrupted context as an exception frame on the
+ * task stack and stores the frame address in pxTopOfStack, the first member of the TCB */
+#if defined(CONFIG_IDF_TARGET_ARCH_XTENSA)				// XtExcFrame, XT_STK_PC at offset 4
+	#define rtosSAMPLE_PC(th)		((*(u32_t **) (th))[1])
+#else													// RvExcFrame, mepc at offset 0
+	#define rtosSAMPLE_PC(th)		((*(u32_t **) (th))[0])
+#endif
+
+// ##################################### Histogram support #########################################
+
+/**
+ * @brief		add a value to a log2 histogram
+ * @param[in]	psH pointer to histogram
+ * @param[in]	Val value to be added
+ */
+static void vRtosHistAdd(rtos_hist_t * psH, u64_t Val) {
+	int i = (Val == 0ULL) ? 0 : (64 - __builtin_clzll(Val));
+	++psH->Bin[(i < rtosHIST_BINS) ? i : (rtosHIST_BINS - 1)];
+}
+
+/**
+ * @brief		report the bins of a log2 histogram as a single line
+ * @param[in]	psR pointer to report control structure
+ * @param[in]	pcTag string identifying the histogram
+ * @param[in]	psH pointer to histogram
+ * @return		size of character output generated
+ */
+static int xRtosHistReport(report_t * psR, const char * pcTag, rtos_hist_t * psH) {
+	int iRV = xReport(psR, "    %s", pcTag);
+	for (int i = 0; i < rtosHIST_BINS; ++i)
+		iRV += xReport(psR, " %lu", psH->Bin[i]);
+	return iRV + xReport(psR, strNL);
+}
+
+// ###################################### Render support ###########################################
+
+/* Reports are formatted into a memory buffer without holding the console lock, the buffer is emitted
+ * with a single xReport() call (console locked only for the duration of the write). Two static buffers
+ * allow a second report to format while the first is being emitted, if both are busy or the output
+ * is larger than the buffer, the content is emitted in chunks as the buffer fills up. Text up to the
+ * header mark is emitted in colour. */
+typedef struct rtos_render_t {
+	report_t * psR;
+	char * pcBuf;
+	size_t Used;
+	size_t Hdr;											// 1st char after (terminated) coloured header, 0 if none
+	int iRV;
+	int Idx;											// static buffer index, -1 if heap allocated
+} rtos_render_t;
+
+static char caRender[2][rtosRENDER_BUF_SIZE];
+static u8_t RenderBusy[2] = { 0 };
+
+/**
+ * @brief		claim a render buffer
+ * @param[in]	psRB pointer to render control structure
+ * @param[in]	psR pointer to report control structure used for the eventual output
+ * @return		erSUCCESS or erFAILURE if no buffer available
+ */
+static int xRtosRenderStart(rtos_render_t * psRB, report_t * psR) {
+	memset(psRB, 0, sizeof(rtos_render_t));
+	psRB->psR = psR;
+	for (int i = 0; i < 2; ++i) {
+		u8_t Free = 0;
+		if (__atomic_compare_exchange_n(&RenderBusy[i], &Free, 1, 0, __ATOMIC_ACQUIRE, __ATOMIC_RELAXED)) {
+			psRB->pcBuf = caRender[i];
+			psRB->Idx = i;
+			return erSUCCESS;
+		}
+	}
+	psRB->pcBuf = pvPortMalloc(rtosRENDER_BUF_SIZE);
+	psRB->Idx = -1;
+	return psRB->pcBuf ? erSUCCESS : erFAILURE;
+}
+
+/**
+ * @brief		emit the buffered content with a single xReport() call and empty the buffer
+ * @param[in]	psRB pointer to render control structure
+ */
+static void vRtosRenderFlush(rtos_render_t * psRB) {
+	if (psRB->Used == 0)
+		return;
+	report_t * psR = psRB->psR;
+	if (psRB->Hdr)
+		psRB->iRV += xReport(psR, "%C%s%C%s", xpfCOL(colourFG_CYAN,0), psRB->pcBuf, xpfCOL(attrRESET,0), psRB->pcBuf + psRB->Hdr);
+	else
+		psRB->iRV += xReport(psR, "%s", psRB->pcBuf);
+	psRB->Used = psRB->Hdr = 0;
+}
+
+/**
+ * @brief		format and append to the render buffer, flushing in chunks if full
+ * @param[in]	psRB pointer to render control structure
+ * @param[in]	pcFmt printf style format string, standard C conversions only
+ */
+static void __attribute__((format(printf, 2, 3))) vRtosRenderAdd(rtos_render_t * psRB, const char * pcFmt, ...) {
+	for (int Try = 0; Try < 2; ++Try) {
+		size_t Size = rtosRENDER_BUF_SIZE - psRB->Used;
+		va_list vaList;
+		va_start(vaList, pcFmt);
+		int iRV = vsnprintf(psRB->pcBuf + psRB->Used, Size, pcFmt, vaList);
+		va_end(vaList);
+		if (iRV < 0)
+			return;
+		if ((size_t) iRV < Size) {
+			psRB->Used += iRV;
+			return;
+		}
+		psRB->pcBuf[psRB->Used] = '\0';				// remove truncated part, flush & retry
+		if (psRB->Used == 0) {							// larger than the buffer, truncate
+			psRB->Used = rtosRENDER_BUF_SIZE - 1;
+			return;
+		}
+		vRtosRenderFlush(psRB);
+	}
+}
+
+/**
+ * @brief		mark everything added so far as (coloured) header
+ * @param[in]	psRB pointer to render control structure
+ */
+static void vRtosRenderHeader(rtos_render_t * psRB) {
+	if (psRB->Used + 1 < rtosRENDER_BUF_SIZE) {			// skip over terminator, start body
+		psRB->Hdr = ++psRB->Used;
+		psRB->pcBuf[psRB->Used] = '\0';
+	}
+}
+
+/**
+ * @brief		emit remaining content and release the render buffer
+ * @param[in]	psRB pointer to render control structure
+ * @return		size of character output generated
+ */
+static int xRtosRenderEnd(rtos_render_t * psRB) {
+	vRtosRenderFlush(psRB);
+	if (psRB->Idx < 0)
+		vPortFree(psRB->pcBuf);
+	else
+		__atomic_store_n(&RenderBusy[psRB->Idx], 0, __ATOMIC_RELEASE);
+	return psRB->iRV;
+}
+
+/**
+ * @brief		format a u64 value with thousands separators
+ * @param[out]	pcBuf buffer for result, at least 27 characters
+ * @param[in]	Val value to format
+ * @return		pointer to the formatted string
+ */
+static char * pcRtosU64Group(char * pcBuf, u64_t Val) {
+	char caTmp[20];
+	int n = 0, i = 0;
+	do {
+		caTmp[n++] = '0' + (Val % 10ULL);
+		Val /= 10ULL;
+	} while (Val);
+	while (n) {
+		pcBuf[i++] = caTmp[--n];
+		if (n && (n % 3) == 0)
+			pcBuf[i++] = ',';
+	}
+	pcBuf[i] = '\0';
+	return pcBuf;
+}
+
+// ###################################### Wake-up latency ##########################################
+
+#if (rtosWAKE > 0)
+typedef struct wake_stat_t {
+	u32_t Count;
+	u64_t tSum, tMax;
+	rtos_hist_t sHist;
+} wake_stat_t;
+
+typedef struct wake_wait_t {
+	TaskHandle_t thWaiter;								// NULL = free slot, claimed with CAS
+	const void * pvKey;									// NULL = slot not (yet) valid
+	u64_t tGive;										// 0 = not yet stamped
+	u64_t tRun;											// 0 = not yet switched in after stamp
+	u8_t GiveCore, RunCore;
+} wake_wait_t;
+
+static wake_wait_t sWakeWait[rtosWAKE_WAITERS] = { 0 };
+static struct { const void * pvKey; wake_stat_t sS[2]; } sWakePrim[rtosWAKE_PRIMS] = { 0 };	// [0] same core, [1] cross core
+static struct { TaskHandle_t thTask; wake_stat_t sS[2]; } sWakeTask[rtosWAKE_TASKS] = { 0 };
+static portMUX_TYPE muxWake = portMUX_INITIALIZER_UNLOCKED;
+static u32_t WakePending = 0;							// stamped slots not yet switched in, skip hook scan if 0
+static u32_t WakeOverflow = 0;
+
+static void vRtosWakeStatAdd(wake_stat_t * psS, u64_t tLat) {
+	++psS->Count;
+	psS->tSum += tLat;
+	if (tLat > psS->tMax)
+		psS->tMax = tLat;
+	vRtosHistAdd(&psS->sHist, tLat);
+}
+
+/**
+ * @brief		register the current task as about to block on a primitive
+ * @param[in]	pvKey semaphore or event group handle
+ * @return		pointer to wait slot or NULL if table full or called from ISR
+ */
+static wake_wait_t * psRtosWakeWaitStart(const void * pvKey) {
+	if (halNVIC_CalledFromISR())
+		return NULL;
+	TaskHandle_t thMe = xTaskGetCurrentTaskHandle();
+	for (int i = 0; i < rtosWAKE_WAITERS; ++i) {
+		wake_wait_t * psW = &sWakeWait[i];
+		TaskHandle_t thFree = NULL;
+		if (psW->thWaiter || __atomic_compare_exchange_n(&psW->thWaiter, &thFree, thMe, 0, __ATOMIC_ACQUIRE, __ATOMIC_RELAXED) == 0)
+			continue;
+		psW->tGive = psW->tRun = 0ULL;
+		__atomic_store_n(&psW->pvKey, pvKey, __ATOMIC_RELEASE);
+		return psW;
+	}
+	__atomic_fetch_add(&WakeOverflow, 1, __ATOMIC_RELAXED);
+	return NULL;
+}
+
+/**
+ * @brief		deregister, if the primitive was obtained after a stamped give/set record the latency
+ * @param[in]	psW pointer to wait slot
+ * @param[in]	bGot true if the wait was satisfied
+ */
+static void vRtosWakeWaitEnd(wake_wait_t * psW, bool bGot) {
+	u64_t tNow = rtosRT_NOW();
+	int Core = esp_cpu_get_core_id();
+	taskENTER_CRITICAL(&muxWake);
+	const void * pvKey = psW->pvKey;					// primitive key, slot key cleared to stop stamping
+	__atomic_store_n(&psW->pvKey, NULL, __ATOMIC_RELEASE);
+	if (psW->tGive && psW->tRun == 0ULL) {				// stamped, switch-in hook not (yet) seen
+		--WakePending;
+		psW->tRun = tNow;
+		psW->RunCore = Core;
+	}
+	if (bGot && psW->tGive) {
+		u64_t tLat = psW->tRun - psW->tGive;
+		int X = (psW->GiveCore != psW->RunCore);
+		int Idx = -1;									// find, else claim first free, primitive record
+		for (int i = 0; i < rtosWAKE_PRIMS; ++i) {
+			if (sWakePrim[i].pvKey == pvKey) {
+				Idx = i;
+				break;
+			}
+			if (Idx < 0 && sWakePrim[i].pvKey == NULL)
+				Idx = i;
+		}
+		if (Idx >= 0) {
+			sWakePrim[Idx].pvKey = pvKey;
+			vRtosWakeStatAdd(&sWakePrim[Idx].sS[X], tLat);
+		} else {
+			++WakeOverflow;
+		}
+		Idx = -1;										// same for the task record
+		for (int i = 0; i < rtosWAKE_TASKS; ++i) {
+			if (sWakeTask[i].thTask == psW->thWaiter) {
+				Idx = i;
+				break;
+			}
+			if (Idx < 0 && sWakeTask[i].thTask == NULL)
+				Idx = i;
+		}
+		if (Idx >= 0) {
+			sWakeTask[Idx].thTask = psW->thWaiter;
+			vRtosWakeStatAdd(&sWakeTask[Idx].sS[X], tLat);
+		}
+	}
+	taskEXIT_CRITICAL(&muxWake);
+	__atomic_store_n(&psW->thWaiter, NULL, __ATOMIC_RELEASE);
+}
+
+/**
+ * @brief		release the statistics of a deleted primitive and/or task, and any wait slot of the task
+ * @param[in]	pvKey semaphore handle, NULL if none
+ * @param[in]	thTask task handle, NULL if none
+ * @note		event groups have no delete wrapper, their records are only reused once the table is full
+ */
+static void vRtosWakeRelease(const void * pvKey, TaskHandle_t thTask) {
+	taskENTER_CRITICAL(&muxWake);
+	for (int i = 0; pvKey && i < rtosWAKE_PRIMS; ++i) {
+		if (sWakePrim[i].pvKey == pvKey) {
+			memset(&sWakePrim[i], 0, sizeof(sWakePrim[i]));
+			break;
+		}
+	}
+	for (int i = 0; thTask && i < rtosWAKE_TASKS; ++i) {
+		if (sWakeTask[i].thTask == thTask) {
+			memset(&sWakeTask[i], 0, sizeof(sWakeTask[i]));
+			break;
+		}
+	}
+	for (int i = 0; thTask && i < rtosWAKE_WAITERS; ++i) {	// deleted while blocked
+		wake_wait_t * psW = &sWakeWait[i];
+		if (psW->thWaiter != thTask)
+			continue;
+		if (psW->tGive && psW->tRun == 0ULL)
+			--WakePending;
+		__atomic_store_n(&psW->pvKey, NULL, __ATOMIC_RELEASE);
+		__atomic_store_n(&psW->thWaiter, NULL, __ATOMIC_RELEASE);
+	}
+	taskEXIT_CRITICAL(&muxWake);
+}
+
+void vRtosWakeGive(const void * pvKey) {
+	u64_t tNow = rtosRT_NOW();
+	int Core = esp_cpu_get_core_id();
+	portENTER_CRITICAL_SAFE(&muxWake);
+	for (int i = 0; i < rtosWAKE_WAITERS; ++i) {
+		wake_wait_t * psW = &sWakeWait[i];
+		if (__atomic_load_n(&psW->pvKey, __ATOMIC_ACQUIRE) != pvKey || psW->tRun)
+			continue;									// other primitive or already running
+		if (psW->tGive == 0ULL)
+			++WakePending;
+		psW->tGive = tNow;								// restamp, the last give before running did the wake
+		psW->GiveCore = Core;
+	}
+	portEXIT_CRITICAL_SAFE(&muxWake);
+}
+
+void vRtosWakeSwitchIn(void) {
+	if (__atomic_load_n(&WakePending, __ATOMIC_RELAXED) == 0)
+		return;
+	TaskHandle_t thMe = xTaskGetCurrentTaskHandle();
+	portENTER_CRITICAL_SAFE(&muxWake);
+	for (int i = 0; i < rtosWAKE_WAITERS; ++i) {
+		wake_wait_t * psW = &sWakeWait[i];
+		if (psW->thWaiter != thMe || psW->tGive == 0ULL || psW->tRun)
+			continue;
+		psW->tRun = rtosRT_NOW();
+		psW->RunCore = esp_cpu_get_core_id();
+		--WakePending;
+		break;
+	}
+	portEXIT_CRITICAL_SAFE(&muxWake);
+}
+
+EventBits_t xRtosEventGroupSet(EventGroupHandle_t xEG, EventBits_t ebX) {
+	vRtosWakeGive(xEG);
+	return xEventGroupSetBits(xEG, ebX);
+}
+
+EventBits_t xRtosEventGroupWait(EventGroupHandle_t xEG, EventBits_t ebX, BaseType_t bClear, BaseType_t bAll, TickType_t tW) {
+	EventBits_t ebRV = xEventGroupGetBits(xEG);
+	if ((bAll ? ((ebRV & ebX) == ebX) : (ebRV & ebX)) || tW == 0)	// satisfied or no wait, no handoff
+		return xEventGroupWaitBits(xEG, ebX, bClear, bAll, 0);
+	wake_wait_t * psW = psRtosWakeWaitStart(xEG);
+	ebRV = xEventGroupWaitBits(xEG, ebX, bClear, bAll, tW);
+	if (psW)
+		vRtosWakeWaitEnd(psW, bAll ? ((ebRV & ebX) == ebX) : (ebRV & ebX));
+	return ebRV;
+}
+
+/**
+ * @brief		find combined (same + cross core) wake latency of a task
+ * @param[in]	xHandle task handle
+ * @param[out]	ptMax maximum latency
+ * @return		average latency, 0 if none recorded
+ */
+static u64_t xRtosWakeTaskLatency(TaskHandle_t xHandle, u64_t * ptMax) {
+	u64_t tAvg = 0ULL;
+	*ptMax = 0ULL;
+	taskENTER_CRITICAL(&muxWake);
+	for (int i = 0; i < rtosWAKE_TASKS; ++i) {
+		if (sWakeTask[i].thTask != xHandle)
+			continue;
+		wake_stat_t * psS = sWakeTask[i].sS;
+		u32_t Count = psS[0].Count + psS[1].Count;
+		tAvg = Count ? (psS[0].tSum + psS[1].tSum) / Count : 0ULL;
+		*ptMax = (psS[0].tMax > psS[1].tMax) ? psS[0].tMax : psS[1].tMax;
+		break;
+	}
+	taskEXIT_CRITICAL(&muxWake);
+	return tAvg;
+}
+
+static int xRtosReportWakeStat(report_t * psR, const char * pcName, wake_stat_t * psS) {
+	int iRV = xReport(psR, "%-16.16s", pcName);
+	for (int X = 0; X < 2; ++X)
+		iRV += xReport(psR, " %6lu %6llu %6llu", psS[X].Count, psS[X].Count ? psS[X].tSum / psS[X].Count : 0ULL, psS[X].tMax);
+	iRV += xReport(psR, strNL);
+	if (psR->sFM.bXtras) {
+		if (psS[0].Count)	iRV += xRtosHistReport(psR, "Same", &psS[0].sHist);
+		if (psS[1].Count)	iRV += xRtosHistReport(psR, "Cross", &psS[1].sHist);
+	}
+	return iRV;
+}
+#endif
+
 // ##################################### Semaphore support #########################################
 
 #define rtosSEMA_EARLY				1					// level to enable pre RTOS activity
-#define rtosSEMA_BLOCK				2					// level to enable actual BLOCKing
+#define rtosSEMA_BLOCK				2					// level to report long BLOCKing waits on every check
 #define rtosSEMA_WRAP				3					// level to enable initial TAKE & GIVE activity
 #define rtosSEMA_STACK				3					// level to enable stack TRACEback reporting
 
 #if	(rtosSEMA_DEBUG > 0)
 
+#if (rtosSEMA_TRACE_SIZE & (rtosSEMA_TRACE_SIZE - 1))
+	#error "rtosSEMA_TRACE_SIZE must be a power of 2 !!!"
+#endif
+
+enum { semaE_TAKE, semaTAKE, semaGIVE, semaE_GIVE, semaINIT, semaDEL };
+static const char * const caSemaEvent[] = { "E_TAKE", "TAKE", "GIVE", "E_GIVE", "INIT", "DEL" };
+
+/* Fixed size binary trace record. Seq is written last with the (reserved index + 1) to publish
+ * the record, the consumer only accepts a record once Seq matches the index it expects. */
+typedef struct sema_evt_t {
+	u32_t Seq;
+	u32_t tStamp;										// runtime counter, low 32 bits
+	SemaphoreHandle_t * pSH;
+	void * pvCaller;									// return address in caller of the wrapper
+	TickType_t tElap;
+	u8_t Type;
+	u8_t Core;
+	char caHldr[8];										// names copied, tasks could be gone when drained
+	char caReqr[8];
+	#if (rtosSEMA_STACK_DEPTH > 0)
+	u32_t Stack[rtosSEMA_STACK_DEPTH];					// backtrace PCs, 0 terminated if shorter
+	#endif
+} sema_evt_t;
+
+/* Per-core multi producer, single consumer ring. Head is advanced with CAS so any task or ISR
+ * (even one migrating between cores) can reserve a slot without locking, Tail only by the drain. */
+typedef struct sema_ring_t {
+	u32_t Head;
+	u32_t Tail;
+	u32_t Dropped;										// records lost due to ring being full
+	u32_t Reported;										// value of Dropped at last drain
+	sema_evt_t sEvt[rtosSEMA_TRACE_SIZE];
+} sema_ring_t;
+
+static sema_ring_t sSemaRing[portNUM_PROCESSORS] = { 0 };
+static TaskHandle_t thSemaDrain = NULL;
+
 SemaphoreHandle_t * pSHmatch = NULL;
 SemaphoreHandle_t * MonitorList[] = { &shUARTmux, &shSLvars, &shSLsock,		/* &shTaskInfo  */ };
 
+/* Monitored semaphores are kept in a small open addressed (linear probing) hash table keyed on the
+ * address of the handle, so membership costs the same irrespective of the number registered. Only
+ * register/unregister modify the table, under muxSemaMon, lookups from TAKE/GIVE (and ISRs) are
+ * lock free. The backward shift on removal briefly moves live entries, so it makes SemaMonGen odd
+ * for its duration and a lookup retries if the generation was odd or changed while it probed. */
+#if (rtosSEMA_MON_SIZE & (rtosSEMA_MON_SIZE - 1))
+	#error "rtosSEMA_MON_SIZE must be a power of 2 !!!"
+#endif
+
+enum { semMON_EMPTY, semMON_BUSY, semMON_READY };
+
+static SemaphoreHandle_t * SemaMonKey[rtosSEMA_MON_SIZE] = { 0 };
+static u8_t SemaMonLevel[rtosSEMA_MON_SIZE] = { 0 };	// 0 = follow ioFRlevel, else level for this handle
+static u8_t SemaMonCount = 0;
+static u8_t SemaMonState = semMON_EMPTY;
+static u32_t SemaMonGen = 0;							// odd while entries are being shifted
+static portMUX_TYPE muxSemaMon = portMUX_INITIALIZER_UNLOCKED;
+
+static u32_t xRtosSemaMonHash(SemaphoreHandle_t * pSH) {
+	return ((u32_t) (uintptr_t) pSH * 0x9E3779B1UL) >> (32 - __builtin_ctz(rtosSEMA_MON_SIZE));
+}
+
 /**
- * @brief	match semaphore address provided against list entries
- * @param	pSH	pointer to semaphore handle
- * @return	1 if found in list else 0
-*/
-static bool xRtosSemaphoreCheckList(SemaphoreHandle_t * pSH) {
-	for(int i = 0; i < NO_MEM(MonitorList); ++i) {
-		if (MonitorList[i] == pSH)
-			return 1;
+ * @brief		add or update an entry in the monitor table, caller must hold muxSemaMon
+ * @return		erSUCCESS or erFAILURE if table full
+ */
+static int xRtosSemaMonInsert(SemaphoreHandle_t * pSH, int Level) {
+	u32_t i = xRtosSemaMonHash(pSH);
+	while (SemaMonKey[i] && SemaMonKey[i] != pSH)
+		i = (i + 1) & (rtosSEMA_MON_SIZE - 1);
+	if (SemaMonKey[i] == NULL) {
+		if (SemaMonCount >= (rtosSEMA_MON_SIZE * 3 / 4))
+			return erFAILURE;							// keep probe sequences short
+		++SemaMonCount;
 	}
-	return 0;
+	SemaMonLevel[i] = Level;
+	__atomic_store_n(&SemaMonKey[i], pSH, __ATOMIC_RELEASE);
+	return erSUCCESS;
+}
+
+/**
+ * @brief		one-time registration of the compile time MonitorList entries
+ */
+static void vRtosSemaMonInit(void) {
+	u8_t State = semMON_EMPTY;
+	if (__atomic_compare_exchange_n(&SemaMonState, &State, semMON_BUSY, 0, __ATOMIC_ACQ_REL, __ATOMIC_ACQUIRE) == 0)
+		return;											// already done or in progress on other core
+	portENTER_CRITICAL_SAFE(&muxSemaMon);
+	for(int i = 0; i < NO_MEM(MonitorList); ++i)
+		xRtosSemaMonInsert(MonitorList[i], 0);
+	portEXIT_CRITICAL_SAFE(&muxSemaMon);
+	__atomic_store_n(&SemaMonState, semMON_READY, __ATOMIC_RELEASE);
 }
 
 /**
- * @brief		check whether semaphore activity should be tracked based on various criteria
+ * @brief		determine the trace level applicable to a semaphore
  * @param[in]	pSH - pointer to (address of) SemaphoreHandle_t to be checked
- * @return		1 if a match or specified in table or tracking enabled, else 0
+ * @return		0 if not monitored, else level registered for the handle or ioFRlevel if registered as 0
  */
-static bool xRtosSemaphoreCheck(SemaphoreHandle_t * pSH) {
-	return ((pSHmatch && (pSH == pSHmatch)) || xRtosSemaphoreCheckList(pSH)) ? 1 : 0;
+static int xRtosSemaphoreLevel(SemaphoreHandle_t * pSH) {
+	if (SemaMonState != semMON_READY)
+		vRtosSemaMonInit();
+	if (SemaMonCount == 0)
+		return 0;
+	u32_t Gen;
+	int Level;
+	do {
+		while ((Gen = __atomic_load_n(&SemaMonGen, __ATOMIC_ACQUIRE)) & 1);	// removal in progress on other core
+		Level = -1;
+		u32_t i = xRtosSemaMonHash(pSH);
+		while (1) {
+			SemaphoreHandle_t * pKey = __atomic_load_n(&SemaMonKey[i], __ATOMIC_ACQUIRE);
+			if (pKey == pSH) {
+				Level = __atomic_load_n(&SemaMonLevel[i], __ATOMIC_RELAXED);
+				break;
+			}
+			if (pKey == NULL)
+				break;
+			i = (i + 1) & (rtosSEMA_MON_SIZE - 1);
+		}
+		__atomic_thread_fence(__ATOMIC_ACQUIRE);
+	} while (__atomic_load_n(&SemaMonGen, __ATOMIC_RELAXED) != Gen);
+	return (Level < 0) ? 0 : Level ? Level : OPT_GET(ioFRlevel);
+}
+
+int xRtosSemaphoreMonitor(SemaphoreHandle_t * pSH, int Level) {
+	if (pSH == NULL || INRANGE(0, Level, UINT8_MAX) == 0)
+		return erINV_PARA;
+	if (SemaMonState != semMON_READY)
+		vRtosSemaMonInit();
+	taskENTER_CRITICAL(&muxSemaMon);
+	int iRV = xRtosSemaMonInsert(pSH, Level);
+	taskEXIT_CRITICAL(&muxSemaMon);
+	return iRV;
+}
+
+int xRtosSemaphoreUnmonitor(SemaphoreHandle_t * pSH) {
+	if (SemaMonState != semMON_READY)
+		vRtosSemaMonInit();
+	int iRV = erFAILURE;
+	taskENTER_CRITICAL(&muxSemaMon);
+	u32_t i = xRtosSemaMonHash(pSH);
+	while (SemaMonKey[i] && SemaMonKey[i] != pSH)
+		i = (i + 1) & (rtosSEMA_MON_SIZE - 1);
+	if (SemaMonKey[i]) {								// found, remove & close the gap (backward shift)
+		__atomic_store_n(&SemaMonGen, SemaMonGen + 1, __ATOMIC_RELAXED);
+		__atomic_thread_fence(__ATOMIC_RELEASE);		// odd generation visible before any entry moves
+		__atomic_store_n(&SemaMonKey[i], NULL, __ATOMIC_RELAXED);
+		--SemaMonCount;
+		u32_t j = i;
+		while (1) {
+			j = (j + 1) & (rtosSEMA_MON_SIZE - 1);
+			if (SemaMonKey[j] == NULL)
+				break;
+			u32_t h = xRtosSemaMonHash(SemaMonKey[j]);
+			// entry at j can move into the gap at i unless its home h lies cyclically in (i, j]
+			if ((i <= j) ? ((i < h) && (h <= j)) : ((i < h) || (h <= j)))
+				continue;
+			__atomic_store_n(&SemaMonLevel[i], SemaMonLevel[j], __ATOMIC_RELAXED);
+			__atomic_store_n(&SemaMonKey[i], SemaMonKey[j], __ATOMIC_RELAXED);
+			__atomic_store_n(&SemaMonKey[j], NULL, __ATOMIC_RELAXED);
+			i = j;
+		}
+		__atomic_store_n(&SemaMonGen, SemaMonGen + 1, __ATOMIC_RELEASE);
+		iRV = erSUCCESS;
+	}
+	taskEXIT_CRITICAL(&muxSemaMon);
+	return iRV;
+}
+
+int xRtosReportSemaphoreMonitor(report_t * psR) {
+	int iRV = xReport(psR, "%CMonitored%C (%d/%d):", xpfCOL(colourFG_CYAN,0), xpfCOL(attrRESET,0), SemaMonCount, rtosSEMA_MON_SIZE);
+	for (int i = 0; i < rtosSEMA_MON_SIZE; ++i) {
+		SemaphoreHandle_t * pSH = SemaMonKey[i];
+		if (pSH)
+			iRV += xReport(psR, " %p=%p/L%d", pSH, *pSH, SemaMonLevel[i]);
+	}
+	return iRV + xReport(psR, fmTST(aNL) ? strNLx2 : strNL);
 }
 
-void xRtosSemaphoreSetMatch(SemaphoreHandle_t * Match) { pSHmatch = Match; }
+void xRtosSemaphoreSetMatch(SemaphoreHandle_t * Match) {
+	if (pSHmatch)
+		xRtosSemaphoreUnmonitor(pSHmatch);
+	pSHmatch = Match;
+	if (Match)
+		xRtosSemaphoreMonitor(Match, 0);
+}
 
 /**
- * @brief	report details regarding semaphore handler, receiver, elapsed time etc..
+ * @brief	record semaphore event, holder, requester, elapsed time etc.. in the trace ring of this core
  * @param	pSH	pointer to semaphore handle
- * @param	pcMess string indicating type of event
+ * @param	Type of event
  * @param	tElap elapsed time (ticks)
+ * @note	ISR safe, no locking or console output, decoded & displayed later by the drain task
 */
-static void vRtosSemaphoreReport(SemaphoreHandle_t * pSH, const char * pcMess, TickType_t tElap) {
-	char *pcHldr = pcTaskGetName(xSemaphoreGetMutexHolder(*pSH));
-	SP("sh%s %d %p H=%s R=%s (%lu)" strNL, pcMess, esp_cpu_get_core_id(), pSH, pcHldr, pcTaskGetName(NULL), tElap);
-	int Option = OPT_GET(ioFRlevel);
-	if (Option >= rtosSEMA_STACK && (tElap == 0))
-		esp_backtrace_print(Option);
+__attribute__((always_inline)) static inline void vRtosSemaphoreReport(SemaphoreHandle_t * pSH, int Type, TickType_t tElap) {
+	int Core = esp_cpu_get_core_id();
+	sema_ring_t * psRing = &sSemaRing[Core];
+	u32_t Head = __atomic_load_n(&psRing->Head, __ATOMIC_RELAXED);
+	do {
+		if ((Head - __atomic_load_n(&psRing->Tail, __ATOMIC_ACQUIRE)) >= rtosSEMA_TRACE_SIZE) {
+			__atomic_fetch_add(&psRing->Dropped, 1, __ATOMIC_RELAXED);
+			return;
+		}
+	} while (__atomic_compare_exchange_n(&psRing->Head, &Head, Head + 1, 1, __ATOMIC_ACQ_REL, __ATOMIC_RELAXED) == 0);
+	sema_evt_t * psE = &psRing->sEvt[Head & (rtosSEMA_TRACE_SIZE - 1)];
+	psE->tStamp = (u32_t) rtosRT_NOW();
+	psE->pSH = pSH;
+	psE->pvCaller = __builtin_return_address(0);
+	psE->tElap = tElap;
+	psE->Type = Type;
+	psE->Core = Core;
+	TaskHandle_t thHldr = NULL;
+	if (*pSH && Type != semaDEL)
+		thHldr = halNVIC_CalledFromISR() ? xSemaphoreGetMutexHolderFromISR(*pSH) : xSemaphoreGetMutexHolder(*pSH);
+	if (thHldr)
+		memcpy(psE->caHldr, pcTaskGetName(thHldr), sizeof(psE->caHldr));
+	else
+		psE->caHldr[0] = '-', psE->caHldr[1] = 0;
+	if (xTaskGetSchedulerState() != taskSCHEDULER_NOT_STARTED)
+		memcpy(psE->caReqr, pcTaskGetName(NULL), sizeof(psE->caReqr));
+	else
+		psE->caReqr[0] = '-', psE->caReqr[1] = 0;
+	#if (rtosSEMA_STACK_DEPTH > 0)						// capture now, printed by the drain task
+		psE->Stack[0] = 0;
+		if (tElap == 0 && xRtosSemaphoreLevel(pSH) >= rtosSEMA_STACK) {
+			esp_backtrace_frame_t sF;
+			esp_backtrace_get_start(&sF.pc, &sF.sp, &sF.next_pc);
+			for (int i = 0; i < rtosSEMA_STACK_DEPTH; ++i) {
+				psE->Stack[i] = esp_cpu_process_stack_pc(sF.pc);
+				if (i < (rtosSEMA_STACK_DEPTH - 1) && esp_backtrace_get_next_frame(&sF) == false) {
+					psE->Stack[i + 1] = 0;
+					break;
+				}
+			}
+		}
+	#endif
+	__atomic_store_n(&psE->Seq, Head + 1, __ATOMIC_RELEASE);	// publish
+}
+
+void vRtosSemaphoreTraceDrain(void) {
+	for (int c = 0; c < portNUM_PROCESSORS; ++c) {
+		sema_ring_t * psRing = &sSemaRing[c];
+		u32_t Tail = psRing->Tail;
+		// SP() takes the (possibly traced) UART mutex, adding records while we drain, stop at the snapshot
+		u32_t Head = __atomic_load_n(&psRing->Head, __ATOMIC_ACQUIRE);
+		while (Tail != Head) {
+			sema_evt_t * psE = &psRing->sEvt[Tail & (rtosSEMA_TRACE_SIZE - 1)];
+			if (__atomic_load_n(&psE->Seq, __ATOMIC_ACQUIRE) != (Tail + 1))
+				break;									// empty or next record not yet published
+			sema_evt_t sE = *psE;						// copy out, then release the slot
+			__atomic_store_n(&psRing->Tail, ++Tail, __ATOMIC_RELEASE);
+			SP("sh%s %d %p H=%.8s R=%.8s (%lu) @0x%08lX t=%lu" strNL, caSemaEvent[sE.Type], sE.Core, sE.pSH,
+				sE.caHldr, sE.caReqr, sE.tElap, rtosCALLER_PC(sE.pvCaller), sE.tStamp);
+			#if (rtosSEMA_STACK_DEPTH > 0)
+			if (sE.Stack[0]) {
+				SP("  Backtrace:");
+				for (int i = 0; i < rtosSEMA_STACK_DEPTH && sE.Stack[i]; ++i)
+					SP(" 0x%08lX", sE.Stack[i]);
+				SP(strNL);
+			}
+			#endif
+		}
+		u32_t Dropped = __atomic_load_n(&psRing->Dropped, __ATOMIC_RELAXED);
+		if (Dropped != psRing->Reported) {
+			SP("shTRACE %d dropped %lu (total %lu)" strNL, c, Dropped - psRing->Reported, Dropped);
+			psRing->Reported = Dropped;
+		}
+	}
+}
+
+/* Wait-for graph. Each task blocking in xRtosSemaphoreTake() registers a task -> semaphore edge for
+ * the duration of the wait, the semaphore -> holder edge is obtained from the mutex itself when the
+ * graph is checked. Slots are claimed with CAS on thWaiter, shSema is written last (cleared first)
+ * so the monitor never uses a partially filled slot. */
+#define semWAIT_LONG				0x01				// long wait reported
+#define semWAIT_CYCLE				0x02				// deadlock cycle reported
+
+typedef struct sema_wait_t {
+	TaskHandle_t thWaiter;								// NULL = free slot
+	SemaphoreHandle_t shSema;							// NULL = slot not (yet) valid
+	SemaphoreHandle_t * pSH;
+	TickType_t tStart;
+	u8_t Flags;
+} sema_wait_t;
+
+static sema_wait_t sSemaWait[rtosSEMA_WAIT_MAX] = { 0 };
+static u32_t SemaWaitOverflow = 0, SemaDeadlocks = 0;
+
+/**
+ * @brief		register the current task as waiting on a semaphore
+ * @param[in]	pSH pointer to semaphore handle
+ * @return		pointer to wait slot or NULL if table full
+ */
+static sema_wait_t * psRtosSemaWaitStart(SemaphoreHandle_t * pSH) {
+	TaskHandle_t thMe = xTaskGetCurrentTaskHandle();
+	u32_t i = (u32_t) ((uintptr_t) thMe >> 4) % rtosSEMA_WAIT_MAX;	// start at "home" slot of the task
+	for (int n = 0; n < rtosSEMA_WAIT_MAX; ++n, i = (i + 1) % rtosSEMA_WAIT_MAX) {
+		sema_wait_t * psW = &sSemaWait[i];
+		TaskHandle_t thFree = NULL;
+		if (psW->thWaiter || __atomic_compare_exchange_n(&psW->thWaiter, &thFree, thMe, 0, __ATOMIC_ACQUIRE, __ATOMIC_RELAXED) == 0)
+			continue;
+		psW->pSH = pSH;
+		psW->tStart = xTaskGetTickCount();
+		psW->Flags = 0;
+		__atomic_store_n(&psW->shSema, *pSH, __ATOMIC_RELEASE);
+		return psW;
+	}
+	__atomic_fetch_add(&SemaWaitOverflow, 1, __ATOMIC_RELAXED);
+	return NULL;
+}
+
+/**
+ * @brief		deregister the wait, successful or not
+ * @param[in]	psW pointer to wait slot
+ */
+static void vRtosSemaWaitEnd(sema_wait_t * psW) {
+	__atomic_store_n(&psW->shSema, NULL, __ATOMIC_RELEASE);
+	__atomic_store_n(&psW->thWaiter, NULL, __ATOMIC_RELEASE);
+}
+
+/**
+ * @brief		find the wait slot (if any) of a task
+ * @param[in]	xHandle task handle
+ * @return		pointer to wait slot or NULL if task is not waiting on a semaphore
+ */
+static sema_wait_t * psRtosSemaWaitFind(TaskHandle_t xHandle) {
+	for (int i = 0; i < rtosSEMA_WAIT_MAX; ++i) {
+		sema_wait_t * psW = &sSemaWait[i];
+		if (psW->thWaiter == xHandle && __atomic_load_n(&psW->shSema, __ATOMIC_ACQUIRE))
+			return psW;
+	}
+	return NULL;
+}
+
+/**
+ * @brief		walk the wait-for graph, report deadlock cycles and waits exceeding rtosSEMA_WAIT_WARN
+ * @note		runs in the context of the low priority monitor task, never from the TAKE/GIVE path
+ */
+static void vRtosSemaphoreDeadlockCheck(void) {
+	TickType_t tNow = xTaskGetTickCount();
+	for (int i = 0; i < rtosSEMA_WAIT_MAX; ++i) {
+		sema_wait_t * psW = &sSemaWait[i];
+		SemaphoreHandle_t shSema = __atomic_load_n(&psW->shSema, __ATOMIC_ACQUIRE);
+		if (shSema == NULL)
+			continue;
+		TaskHandle_t thWaiter = psW->thWaiter;
+		TickType_t tElap = tNow - psW->tStart;
+		/* follow waiter -> semaphore -> holder -> semaphore ... until chain ends or returns to waiter.
+		 * Slots can be released at any time, shSema is loaded once per slot and only that copy used */
+		sema_wait_t * psCur;
+		SemaphoreHandle_t shCur = shSema;
+		int Depth;
+		bool bCycle = 0;
+		for (Depth = 0; Depth < rtosSEMA_WAIT_MAX; ++Depth) {
+			TaskHandle_t thHldr = xSemaphoreGetMutexHolder(shCur);
+			if (thHldr == NULL)
+				break;
+			if (thHldr == thWaiter) {
+				bCycle = 1;
+				break;
+			}
+			psCur = psRtosSemaWaitFind(thHldr);
+			if (psCur == NULL || (shCur = __atomic_load_n(&psCur->shSema, __ATOMIC_ACQUIRE)) == NULL)
+				break;
+		}
+		bool bLong = (tElap >= pdMS_TO_TICKS(rtosSEMA_WAIT_WARN));
+		if (bCycle && (psW->Flags & semWAIT_CYCLE) == 0) {
+			psW->Flags |= semWAIT_CYCLE;
+			++SemaDeadlocks;
+		} else if (bLong && (((psW->Flags & semWAIT_LONG) == 0) || xRtosSemaphoreLevel(psW->pSH) >= rtosSEMA_BLOCK)) {
+			psW->Flags |= semWAIT_LONG;					// monitored at BLOCK level, report every check
+		} else {
+			continue;
+		}
+		// report the holder chain, from the waiter onwards
+		SP("sh%s %lu ticks: %s", bCycle ? "DEADLOCK" : "WAIT", tElap, pcTaskGetName(thWaiter));
+		psCur = psW;
+		shCur = shSema;
+		for (int d = 0; d <= Depth; ++d) {
+			TaskHandle_t thHldr = xSemaphoreGetMutexHolder(shCur);
+			SP(" -> %p -> %s", psCur->pSH, thHldr ? pcTaskGetName(thHldr) : "-");
+			if (thHldr == NULL || thHldr == thWaiter)
+				break;
+			psCur = psRtosSemaWaitFind(thHldr);
+			if (psCur == NULL || (shCur = __atomic_load_n(&psCur->shSema, __ATOMIC_ACQUIRE)) == NULL)
+				break;
+		}
+		SP(strNL);
+	}
+	if (SemaWaitOverflow) {
+		SP("shWAIT %lu waits not tracked, increase rtosSEMA_WAIT_MAX" strNL, SemaWaitOverflow);
+		SemaWaitOverflow = 0;
+	}
+}
+
+/**
+ * @brief	monitor task, periodically empties the semaphore trace rings and checks the wait-for graph
+ */
+static void vRtosSemaphoreTraceTask(void * pvPara) {
+	for (u32_t Count = 0; 1; ++Count) {
+		vRtosSemaphoreTraceDrain();
+		if ((Count % 10) == 0)
+			vRtosSemaphoreDeadlockCheck();
+		vTaskDelay(pdMS_TO_TICKS(100));
+	}
+}
+
+void vRtosSemaphoreTraceStart(UBaseType_t uxPriority) {
+	if (thSemaDrain == NULL)
+		xTaskCreate(vRtosSemaphoreTraceTask, "semMon", 3072, NULL, uxPriority, &thSemaDrain);
+}
+
+#endif
+
+#if (rtosSEMA_PROFILE > 0)
+
+#define rtosSEMA_PROF_TOP			4					// candidate slots for "most frequent holder"
+
+/* Profile record attached to each mutex created via xRtosSemaphoreInit(). The record index (+1) is
+ * stored in the queue number field of the mutex so lookup on TAKE/GIVE is O(1). With the exception
+ * of Timeouts and tGiveISR, all fields are only updated by the task holding the mutex, hence serialised
+ * by the mutex itself and no additional locking is required on the TAKE/GIVE path. */
+typedef struct sema_prof_t {
+	SemaphoreHandle_t * pSH;							// address of handle, identifies the mutex
+	SemaphoreHandle_t shSema;							// handle, validates the queue number lookup
+	TaskHandle_t thHolder;								// current holder, NULL if free
+	TaskHandle_t thLast;								// most recent holder
+	u64_t tTaken;										// runtime counter at time of successful TAKE
+	u64_t tWaitSum, tWaitMax;
+	u64_t tHoldSum, tHoldMax;
+	u32_t Takes;										// successful takes
+	u32_t Contended;									// takes that could not be satisfied immediately
+	u32_t Timeouts;										// takes that failed after waiting
+	struct { TaskHandle_t thTask; u32_t Count; } sTop[rtosSEMA_PROF_TOP];
+	u64_t tGiveISR;										// runtime counter at ISR GIVE, 0 if none pending
+	u64_t tWakeSum, tWakeMax;							// ISR GIVE -> blocked TAKE returned
+	u32_t Wakes;
+	rtos_hist_t sWait;
+	rtos_hist_t sHold;
+	rtos_hist_t sWake;
+} sema_prof_t;
+
+static sema_prof_t sSemaProf[rtosSEMA_PROF_MAX] = { 0 };
+static portMUX_TYPE muxSemaProf = portMUX_INITIALIZER_UNLOCKED;
+static u32_t SemaProfOverflow = 0;						// mutexes created with no free record
+
+/**
+ * @brief		find the profile record attached to a mutex
+ * @param[in]	shSema mutex handle
+ * @return		pointer to profile record or NULL if not profiled
+ */
+static sema_prof_t * psRtosSemaProfGet(SemaphoreHandle_t shSema) {
+	UBaseType_t uxNum = uxQueueGetQueueNumber((QueueHandle_t) shSema);
+	if (uxNum == 0 || uxNum > rtosSEMA_PROF_MAX)
+		return NULL;
+	sema_prof_t * psSP = &sSemaProf[uxNum - 1];
+	return (psSP->shSema == shSema) ? psSP : NULL;
+}
+
+/**
+ * @brief		allocate a profile record and attach to the newly created mutex
+ * @param[in]	pSH pointer to semaphore handle
+ * @param[in]	shSema handle of the new mutex, not yet published via pSH
+ */
+static void vRtosSemaProfAttach(SemaphoreHandle_t * pSH, SemaphoreHandle_t shSema) {
+	int i;
+	taskENTER_CRITICAL(&muxSemaProf);
+	for (i = 0; i < rtosSEMA_PROF_MAX; ++i) {
+		sema_prof_t * psSP = &sSemaProf[i];
+		if (psSP->shSema == NULL) {
+			memset(psSP, 0, sizeof(sema_prof_t));
+			psSP->pSH = pSH;
+			psSP->shSema = shSema;
+			vQueueSetQueueNumber((QueueHandle_t) shSema, i + 1);
+			break;
+		}
+	}
+	if (i == rtosSEMA_PROF_MAX)
+		++SemaProfOverflow;
+	taskEXIT_CRITICAL(&muxSemaProf);
+}
+
+/**
+ * @brief		release the profile record (if any) attached to a mutex about to be deleted
+ * @param[in]	shSema mutex handle
+ */
+static void vRtosSemaProfDetach(SemaphoreHandle_t shSema) {
+	taskENTER_CRITICAL(&muxSemaProf);
+	sema_prof_t * psSP = psRtosSemaProfGet(shSema);
+	if (psSP)
+		psSP->shSema = NULL;
+	taskEXIT_CRITICAL(&muxSemaProf);
+}
+
+/**
+ * @brief		update profile after a TAKE attempt
+ * @param[in]	psSP pointer to profile record
+ * @param[in]	btRV result of the TAKE
+ * @param[in]	tStart runtime counter when blocking wait started, 0 if taken without contention
+ */
+static void vRtosSemaProfTake(sema_prof_t * psSP, BaseType_t btRV, u64_t tStart) {
+	if (btRV != pdTRUE) {
+		__atomic_fetch_add(&psSP->Timeouts, 1, __ATOMIC_RELAXED);
+		return;
+	}
+	// From here on we hold the mutex, updates are serialised
+	TaskHandle_t thMe = xTaskGetCurrentTaskHandle();
+	psSP->tTaken = rtosRT_NOW();
+	psSP->thHolder = psSP->thLast = thMe;
+	++psSP->Takes;
+	u64_t tWait = 0ULL;
+	if (tStart) {
+		++psSP->Contended;
+		tWait = psSP->tTaken - tStart;
+		psSP->tWaitSum += tWait;
+		if (tWait > psSP->tWaitMax)
+			psSP->tWaitMax = tWait;
+		u64_t tGive = __atomic_exchange_n(&psSP->tGiveISR, 0ULL, __ATOMIC_RELAXED);
+		if (tGive >= tStart) {							// woken by an ISR GIVE while blocked
+			u64_t tWake = psSP->tTaken - tGive;
+			++psSP->Wakes;
+			psSP->tWakeSum += tWake;
+			if (tWake > psSP->tWakeMax)
+				psSP->tWakeMax = tWake;
+			vRtosHistAdd(&psSP->sWake, tWake);
+		}
+	}
+	vRtosHistAdd(&psSP->sWait, tWait);
+	// space saving algorithm, approximates the most frequent holders in fixed space
+	int iMin = 0;
+	for (int i = 0; i < rtosSEMA_PROF_TOP; ++i) {
+		if (psSP->sTop[i].thTask == thMe) {
+			++psSP->sTop[i].Count;
+			return;
+		}
+		if (psSP->sTop[i].Count < psSP->sTop[iMin].Count)
+			iMin = i;
+	}
+	psSP->sTop[iMin].thTask = thMe;
+	++psSP->sTop[iMin].Count;
+}
+
+/**
+ * @brief		update profile before the GIVE, while the mutex is still held
+ * @param[in]	psSP pointer to profile record
+ */
+static void vRtosSemaProfGive(sema_prof_t * psSP) {
+	if (psSP->thHolder != xTaskGetCurrentTaskHandle())
+		return;											// GIVE will fail, not the holder
+	u64_t tHold = rtosRT_NOW() - psSP->tTaken;
+	psSP->tHoldSum += tHold;
+	if (tHold > psSP->tHoldMax)
+		psSP->tHoldMax = tHold;
+	vRtosHistAdd(&psSP->sHold, tHold);
+	psSP->thHolder = NULL;
+}
+
+void vRtosSemaphoreStatsReset(void) {
+	taskENTER_CRITICAL(&muxSemaProf);
+	for (int i = 0; i < rtosSEMA_PROF_MAX; ++i) {
+		sema_prof_t * psSP = &sSemaProf[i];
+		if (psSP->shSema == NULL)
+			continue;
+		memset(&psSP->tWaitSum, 0, sizeof(sema_prof_t) - offsetof(sema_prof_t, tWaitSum));
+	}
+	SemaProfOverflow = 0;
+	taskEXIT_CRITICAL(&muxSemaProf);
+}
+
+#endif
+
+/**
+ * @brief		wait (block) for the semaphore to become available
+ * @param[in]	pSH pointer to semaphore handle
+ * @param[in]	tWait number of ticks to wait
+ * @param[out]	pbtHPTwoken pointer to flag set if yield required on ISR exit
+ * @return		pdTRUE if taken else pdFALSE
+ */
+static BaseType_t xRtosSemaphoreWait(SemaphoreHandle_t * pSH, TickType_t tWait, BaseType_t * pbtHPTwoken) {
+	if (halNVIC_CalledFromISR())
+		return xSemaphoreTakeFromISR(*pSH, pbtHPTwoken);
+	#if (rtosWAKE > 0)				// register to measure give -> running latency, only stamped if it blocks
+		wake_wait_t * psWW = (tWait > 0) ? psRtosWakeWaitStart(*pSH) : NULL;
+	#endif
+	#if	(rtosSEMA_DEBUG > 0)		// register in wait-for graph, monitor task reports long waits & deadlocks
+		sema_wait_t * psW = (tWait > 0) ? psRtosSemaWaitStart(pSH) : NULL;
+		BaseType_t btRV = xSemaphoreTake(*pSH, tWait);
+		if (psW)
+			vRtosSemaWaitEnd(psW);
+	#else
+		BaseType_t btRV = xSemaphoreTake(*pSH, tWait);
+	#endif
+	#if (rtosWAKE > 0)
+		if (psWW)
+			vRtosWakeWaitEnd(psWW, btRV == pdTRUE);
+	#endif
+	return btRV;
+}
+
+// ################################# Static mutex pool support ####################################
+
+#if (rtosSEMA_POOL_SIZE > 0)
+
+#define rtosSEMA_POOL_WORDS			((rtosSEMA_POOL_SIZE + 31) / 32)
+#define rtosSEMA_POOL_PAD			((rtosSEMA_POOL_SIZE % 32) ? ~((1UL << (rtosSEMA_POOL_SIZE % 32)) - 1UL) : 0UL)
+
+static StaticSemaphore_t sSemaPool[rtosSEMA_POOL_SIZE];
+static u32_t SemaPoolMap[rtosSEMA_POOL_WORDS] = { [rtosSEMA_POOL_WORDS-1] = rtosSEMA_POOL_PAD };	// 1 = in use
+static u32_t SemaPoolUsed = 0, SemaPoolHWM = 0, SemaPoolHeap = 0;
+
+#endif
+
+/**
+ * @brief		create a mutex, from the static pool if a slot is free else from the heap
+ * @return		handle of new mutex, NULL if failed
+ * @note		lock free, pool slots are claimed by CAS on the allocation bitmap
+ */
+static SemaphoreHandle_t xRtosSemaphoreCreate(void) {
+#if (rtosSEMA_POOL_SIZE > 0)
+	for (int w = 0; w < rtosSEMA_POOL_WORDS; ++w) {
+		u32_t Map = __atomic_load_n(&SemaPoolMap[w], __ATOMIC_RELAXED);
+		while (~Map) {									// at least 1 free slot in this word
+			u32_t Bit = 1UL << __builtin_ctzl(~Map);
+			if (__atomic_compare_exchange_n(&SemaPoolMap[w], &Map, Map | Bit, 1, __ATOMIC_ACQUIRE, __ATOMIC_RELAXED)) {
+				u32_t Used = __atomic_add_fetch(&SemaPoolUsed, 1, __ATOMIC_RELAXED);
+				u32_t HWM = __atomic_load_n(&SemaPoolHWM, __ATOMIC_RELAXED);
+				while (Used > HWM && __atomic_compare_exchange_n(&SemaPoolHWM, &HWM, Used, 1, __ATOMIC_RELAXED, __ATOMIC_RELAXED) == 0);
+				return xSemaphoreCreateMutexStatic(&sSemaPool[(w * 32) + __builtin_ctzl(Bit)]);
+			}
+		}
+	}
+	__atomic_fetch_add(&SemaPoolHeap, 1, __ATOMIC_RELAXED);	// pool exhausted, fall back to heap
+#endif
+	return xSemaphoreCreateMutex();
 }
 
+/**
+ * @brief		delete a mutex and return its slot to the static pool if applicable
+ * @param[in]	shSema handle of mutex to delete
+ */
+static void vRtosSemaphoreDestroy(SemaphoreHandle_t shSema) {
+	vSemaphoreDelete(shSema);
+#if (rtosSEMA_POOL_SIZE > 0)
+	StaticSemaphore_t * psSS = (StaticSemaphore_t *) shSema;	// static handle is the buffer address
+	if (psSS >= &sSemaPool[0] && psSS < &sSemaPool[rtosSEMA_POOL_SIZE]) {
+		int i = psSS - &sSemaPool[0];
+		__atomic_fetch_and(&SemaPoolMap[i / 32], ~(1UL << (i % 32)), __ATOMIC_RELEASE);
+		__atomic_fetch_sub(&SemaPoolUsed, 1, __ATOMIC_RELAXED);
+	}
 #endif
+}
 
 SemaphoreHandle_t xRtosSemaphoreInit(SemaphoreHandle_t * pSH) {
-	*pSH = xSemaphoreCreateMutex();
+	SemaphoreHandle_t shNew = xRtosSemaphoreCreate();
+	IF_myASSERT(debugRESULT, shNew != 0);
+	if (shNew == NULL)
+		return NULL;
+	#if (rtosSEMA_PROFILE > 0)
+		vRtosSemaProfAttach(pSH, shNew);				// attach before it becomes visible
+	#endif
+	// publish with CAS, if another task/core was first use theirs and discard ours
+	SemaphoreHandle_t shOld = NULL;
+	if (__atomic_compare_exchange_n(pSH, &shOld, shNew, 0, __ATOMIC_ACQ_REL, __ATOMIC_ACQUIRE) == 0) {
+		#if (rtosSEMA_PROFILE > 0)
+			vRtosSemaProfDetach(shNew);
+		#endif
+		vRtosSemaphoreDestroy(shNew);
+		return shOld;
+	}
 	#if	(rtosSEMA_DEBUG > 0)
-		if (OPT_GET(ioFRlevel) > 1 && xRtosSemaphoreCheck(pSH))
-			SP("shINIT %p=%p" strNL, pSH, *pSH);				// report the event
+		if (xRtosSemaphoreLevel(pSH) > 1)
+			vRtosSemaphoreReport(pSH, semaINIT, 0);			// record the event
 	#endif
-	IF_myASSERT(debugRESULT, *pSH != 0);
-	return *pSH;
+	return shNew;
 }
 
 BaseType_t xRtosSemaphoreTake(SemaphoreHandle_t * pSH, TickType_t tWait) {
 	#if	(rtosSEMA_DEBUG > 0)
-		int Option = OPT_GET(ioFRlevel);
+		int Level = xRtosSemaphoreLevel(pSH);
 	#endif
 	// step 1: if scheduler not (yet) running, fake a result...
 	if (xTaskGetSchedulerState() != taskSCHEDULER_RUNNING) {
 		#if	(rtosSEMA_DEBUG > 0)
-		if (Option >= rtosSEMA_EARLY && xRtosSemaphoreCheck(pSH))
-			vRtosSemaphoreReport(pSH, "E_TAKE", 0);
+		if (Level >= rtosSEMA_EARLY)
+			vRtosSemaphoreReport(pSH, semaE_TAKE, 0);
 		#endif
 		return pdFALSE;
 	}
 
-	// step 2: if semaphore not initialized, do so now... 
+	// step 2: if semaphore not initialized, do so now...
 	if (*pSH == NULL)
 		xRtosSemaphoreInit(pSH);
 
 	// step 3: handle the actual TAKE request
 	BaseType_t btRV, btHPTwoken = pdFALSE;
-	#if	(rtosSEMA_DEBUG > 0)		/* DEBUG enabled **********************************************/
-		// step 3a: setup steps for breaking up the wait period
-		TickType_t tStep, tElap = 0;
-		if (tWait != portMAX_DELAY) {
-			tWait = u32RoundUP(tWait, 10);
-			tStep = tWait / 10;
-		} else {
-			tStep = pdMS_TO_TICKS(10000);
-		}
-
-		// step 3b: 
-		if ((Option >= rtosSEMA_WRAP) && xRtosSemaphoreCheck(pSH))
-			vRtosSemaphoreReport(pSH, "TAKE", tElap);
-		do {	// loop here trying to take the semaphore
-			btRV = halNVIC_CalledFromISR() ? xSemaphoreTakeFromISR(*pSH, &btHPTwoken) : xSemaphoreTake(*pSH, tStep);
-			if (btRV == pdTRUE)								// if successful
-				break;										// break out & return status
-			// report status
-			if (Option >= rtosSEMA_BLOCK)					// if report level match
-				vRtosSemaphoreReport(pSH, "TAKE", tElap);	// report current time info
-			if (tWait != portMAX_DELAY)						// if not indefinite wait
-				tWait -= tStep;								// adjust remaining time
-			tElap += tStep;									// update elapsed time
-		} while (tWait > tStep);							// and try again....
-	#else							/* DEBUG disabled *********************************************/
-		btRV = halNVIC_CalledFromISR() ? xSemaphoreTakeFromISR(*pSH, &btHPTwoken) : xSemaphoreTake(*pSH, tWait);
+	#if (rtosTRACE > 0)
+		vRtosTraceSema(*pSH, rtosTR_SEM_TAKE, 0);
+	#endif
+	#if	(rtosSEMA_DEBUG > 0)
+		if (Level >= rtosSEMA_WRAP)
+			vRtosSemaphoreReport(pSH, semaTAKE, 0);
+	#endif
+	#if (rtosSEMA_PROFILE > 0)
+		// step 3a: if profiled, first try without blocking to detect contention
+		sema_prof_t * psSP = halNVIC_CalledFromISR() ? NULL : psRtosSemaProfGet(*pSH);
+		if (psSP) {
+			u64_t tStart = 0ULL;
+			btRV = xSemaphoreTake(*pSH, 0);
+			if (btRV == pdFALSE) {							// contended, block as requested
+				tStart = rtosRT_NOW();
+				btRV = xRtosSemaphoreWait(pSH, tWait, &btHPTwoken);
+			}
+			vRtosSemaProfTake(psSP, btRV, tStart);
+		} else
+	#endif
+		btRV = xRtosSemaphoreWait(pSH, tWait, &btHPTwoken);
+	#if (rtosTRACE > 0)
+		vRtosTraceSema(*pSH, rtosTR_SEM_TAKE, (btRV == pdTRUE) ? 1 : 2);
 	#endif
 
 	// step 4: based on result, yield if required
@@ -147,24 +1173,39 @@ BaseType_t xRtosSemaphoreTake(SemaphoreHandle_t * pSH, TickType_t tWait) {
 
 BaseType_t xRtosSemaphoreGive(SemaphoreHandle_t * pSH) {
 	#if	(rtosSEMA_DEBUG > 0)
-		int Option = OPT_GET(ioFRlevel);
+		int Level = xRtosSemaphoreLevel(pSH);
 	#endif
 
 	// step 1: if scheduler not (yet) running, fake a result...
 	if (xTaskGetSchedulerState() != taskSCHEDULER_RUNNING || *pSH == 0) {
 		#if	(rtosSEMA_DEBUG > 0)
-		if ((Option >= rtosSEMA_EARLY) && xRtosSemaphoreCheck(pSH))
-			vRtosSemaphoreReport(pSH, "E_GIVE", 0);
+		if (Level >= rtosSEMA_EARLY)
+			vRtosSemaphoreReport(pSH, semaE_GIVE, 0);
 		#endif
 		return pdFALSE;
 	}
 
 	// step 2: handle the actual GIVE request
-	BaseType_t btHPTwoken = pdFALSE;
-	BaseType_t btRV = halNVIC_CalledFromISR() ? xSemaphoreGiveFromISR(*pSH, &btHPTwoken) : xSemaphoreGive(*pSH);
+	BaseType_t btHPTwoken = pdFALSE, btISR = halNVIC_CalledFromISR();
+	#if (rtosSEMA_PROFILE > 0)
+		sema_prof_t * psSP = psRtosSemaProfGet(*pSH);
+		if (psSP) {
+			if (btISR == 0)								// update hold time while still holding
+				vRtosSemaProfGive(psSP);
+			else										// stamp for ISR -> task wake latency
+				__atomic_store_n(&psSP->tGiveISR, rtosRT_NOW(), __ATOMIC_RELAXED);
+		}
+	#endif
+	#if (rtosTRACE > 0)
+		vRtosTraceSema(*pSH, rtosTR_SEM_GIVE, btISR ? 1 : 0);
+	#endif
+	#if (rtosWAKE > 0)
+		vRtosWakeGive(*pSH);							// stamp before the handoff
+	#endif
+	BaseType_t btRV = btISR ? xSemaphoreGiveFromISR(*pSH, &btHPTwoken) : xSemaphoreGive(*pSH);
 	#if	(rtosSEMA_DEBUG > 0)
-	if ((Option >= rtosSEMA_WRAP) && xRtosSemaphoreCheck(pSH))
-		vRtosSemaphoreReport(pSH, "GIVE", 0);
+	if (Level >= rtosSEMA_WRAP)
+		vRtosSemaphoreReport(pSH, semaGIVE, 0);
 	#endif
 	if (btHPTwoken == pdTRUE)
 		portYIELD_FROM_ISR();
@@ -173,12 +1214,18 @@ BaseType_t xRtosSemaphoreGive(SemaphoreHandle_t * pSH) {
 
 void vRtosSemaphoreDelete(SemaphoreHandle_t * pSH) {
 	#if	(rtosSEMA_DEBUG > 0)
-		if ((OPT_GET(ioFRlevel) > 1) && xRtosSemaphoreCheck(pSH))
-			SP("shDEL %p" strNL, pSH);
+		if (xRtosSemaphoreLevel(pSH) > 1)
+			vRtosSemaphoreReport(pSH, semaDEL, 0);
 	#endif
-	if (*pSH) {
-		vSemaphoreDelete(*pSH);							// delete the semaphore
-		*pSH = 0;										// clear the handle storage
+	SemaphoreHandle_t shSema = __atomic_exchange_n(pSH, NULL, __ATOMIC_ACQ_REL);	// clear the handle storage
+	if (shSema) {
+		#if (rtosSEMA_PROFILE > 0)
+			vRtosSemaProfDetach(shSema);
+		#endif
+		#if (rtosWAKE > 0)
+			vRtosWakeRelease(shSema, NULL);
+		#endif
+		vRtosSemaphoreDestroy(shSema);					// delete the semaphore
 	}
 }
 
@@ -192,6 +1239,341 @@ BaseType_t xRtosSemaphoreCheckCurrent(SemaphoreHandle_t * pSH) {
 	return (xHdlr == xTaskGetCurrentTaskHandle());		// return whether current task is holder
 }
 
+// ################################### Adaptive mutex support ######################################
+
+#if (portNUM_PROCESSORS > 1)
+/**
+ * @brief		check if a task is currently running on another core
+ * @param[in]	xHandle task handle
+ * @return		1 if running on a core other than the current core, else 0
+ */
+static bool bRtosTaskRunningElsewhere(TaskHandle_t xHandle) {
+	int Core = esp_cpu_get_core_id();
+	for (int c = 0; c < portNUM_PROCESSORS; ++c) {
+		if (c != Core && xTaskGetCurrentTaskHandleForCore(c) == xHandle)
+			return 1;
+	}
+	return 0;
+}
+#endif
+
+BaseType_t xRtosAMutexTake(rtos_amutex_t * psAM, TickType_t tWait) {
+#if (portNUM_PROCESSORS > 1)
+	// step 1: only spin if the scheduler is running, not in an ISR and willing to wait
+	if (tWait == 0 || xTaskGetSchedulerState() != taskSCHEDULER_RUNNING || halNVIC_CalledFromISR())
+		goto block;
+	if (psAM->shMutex == NULL)
+		xRtosSemaphoreInit(&psAM->shMutex);
+	// step 2: spinning only makes sense while the holder is actively running on another core
+	TaskHandle_t thHolder = xSemaphoreGetMutexHolder(psAM->shMutex);
+	if (thHolder == NULL || bRtosTaskRunningElsewhere(thHolder) == 0)
+		goto block;
+	if (psAM->SpinLimit == 0)
+		psAM->SpinLimit = rtosAMUX_SPIN_INIT;
+	// step 3: bounded spin with exponential backoff between TAKE attempts
+	u64_t tStart = rtosRT_NOW();
+	TickType_t tTick = xTaskGetTickCount();
+	u32_t cStart = esp_cpu_get_cycle_count(), cSpent = 0, cLimit = psAM->SpinLimit, cBackoff = 16;
+	do {
+		for (u32_t cDelay = esp_cpu_get_cycle_count(); (esp_cpu_get_cycle_count() - cDelay) < cBackoff; );
+		if (xSemaphoreTake(psAM->shMutex, 0) == pdTRUE) {
+			// now holding the mutex, updates serialised. Aim limit at twice the spin that succeeded
+			cSpent = esp_cpu_get_cycle_count() - cStart;
+			u32_t cNew = (cLimit + (cSpent * 2)) / 2;
+			psAM->SpinLimit = (cNew > rtosAMUX_SPIN_MAX) ? rtosAMUX_SPIN_MAX : (cNew < rtosAMUX_SPIN_MIN) ? rtosAMUX_SPIN_MIN : cNew;
+			++psAM->Spun;
+			#if (rtosSEMA_PROFILE > 0)
+				sema_prof_t * psSP = psRtosSemaProfGet(psAM->shMutex);
+				if (psSP)
+					vRtosSemaProfTake(psSP, pdTRUE, tStart);
+			#endif
+			#if	(rtosSEMA_DEBUG > 0)
+				if (xRtosSemaphoreLevel(&psAM->shMutex) >= rtosSEMA_WRAP)
+					vRtosSemaphoreReport(&psAM->shMutex, semaTAKE, 0);
+			#endif
+			return pdTRUE;
+		}
+		if (cBackoff < 256)
+			cBackoff <<= 1;
+		cSpent = esp_cpu_get_cycle_count() - cStart;
+	} while (cSpent < cLimit && bRtosTaskRunningElsewhere(xSemaphoreGetMutexHolder(psAM->shMutex)));
+	// step 4: spin failed (timeout or holder blocked/preempted), halve the budget and block
+	if (cSpent >= cLimit)
+		psAM->SpinLimit = (cLimit / 2 < rtosAMUX_SPIN_MIN) ? rtosAMUX_SPIN_MIN : cLimit / 2;
+	__atomic_fetch_add(&psAM->Failed, 1, __ATOMIC_RELAXED);
+	if (tWait != portMAX_DELAY) {						// adjust remaining wait for time spent spinning
+		TickType_t tSpun = xTaskGetTickCount() - tTick;
+		tWait = (tSpun < tWait) ? (tWait - tSpun) : 0;
+	}
+block:
+#endif
+	if (xRtosSemaphoreTake(&psAM->shMutex, tWait) != pdTRUE)
+		return pdFALSE;
+	++psAM->Direct;
+	return pdTRUE;
+}
+
+BaseType_t xRtosAMutexGive(rtos_amutex_t * psAM) { return xRtosSemaphoreGive(&psAM->shMutex); }
+
+void vRtosAMutexDelete(rtos_amutex_t * psAM) {
+	vRtosSemaphoreDelete(&psAM->shMutex);
+	psAM->SpinLimit = psAM->Spun = psAM->Failed = psAM->Direct = 0;
+}
+
+int xRtosReportAMutex(report_t * psR, rtos_amutex_t * psAM, const char * pcName) {
+	int iRV = xReport(psR, "%C%s%C\t%p  Spin=%lu  Fail=%lu  Direct=%lu  Limit=%lu", xpfCOL(colourFG_CYAN,0), pcName,
+		xpfCOL(attrRESET,0), psAM->shMutex, psAM->Spun, psAM->Failed, psAM->Direct, psAM->SpinLimit);
+	if (fmTST(aNL))
+		iRV += xReport(psR, strNL);
+	return iRV;
+}
+
+// ################################### Reader/Writer lock support ##################################
+
+/* State word: bits 0-15 reader count, plus writer pending/active flags. Readers are admitted with a
+ * CAS on the state word, no kernel objects involved unless they have to wait. Writers serialise on
+ * shWriter (priority inheritance between writers) and readers that have to wait for a writer do so
+ * by blocking on shWriter as well, so they also donate their priority to the writer. The last reader
+ * out gives shDrain to wake a writer waiting for readers to drain. */
+#define rwREADERS					0x0000FFFFUL
+#define rwW_PEND					0x00010000UL
+#define rwW_ACTIVE					0x00020000UL
+
+enum { rwINIT_NONE, rwINIT_BUSY, rwINIT_DONE };
+
+/**
+ * @brief		one-time creation of the kernel objects, safe if raced from multiple tasks/cores
+ * @param[in]	psRW pointer to reader/writer lock
+ */
+static void vRtosRWLockInit(rtos_rwlock_t * psRW) {
+	u8_t Init = rwINIT_NONE;
+	if (__atomic_compare_exchange_n(&psRW->Init, &Init, rwINIT_BUSY, 0, __ATOMIC_ACQ_REL, __ATOMIC_ACQUIRE)) {
+		psRW->shDrain = xSemaphoreCreateBinaryStatic(&psRW->ssDrain);
+		xRtosSemaphoreInit(&psRW->shWriter);
+		__atomic_store_n(&psRW->Init, rwINIT_DONE, __ATOMIC_RELEASE);
+	} else {
+		while (__atomic_load_n(&psRW->Init, __ATOMIC_ACQUIRE) != rwINIT_DONE)
+			vTaskDelay(1);								// other task busy creating, wait for it
+	}
+}
+
+BaseType_t xRtosRWLockTakeRead(rtos_rwlock_t * psRW, TickType_t tWait) {
+	// step 1: if scheduler not (yet) running, fake a result...
+	if (xTaskGetSchedulerState() != taskSCHEDULER_RUNNING)
+		return pdFALSE;
+	// step 2: if not initialised, do so now, not possible from ISR
+	bool bISR = halNVIC_CalledFromISR();
+	if (psRW->Init != rwINIT_DONE) {
+		if (bISR)
+			return pdFALSE;
+		vRtosRWLockInit(psRW);
+	}
+	// step 3: try to join the readers, else wait behind the writer
+	u32_t Block = psRW->bReaderPref ? rwW_ACTIVE : (rwW_ACTIVE | rwW_PEND);
+	bool bWaited = 0;
+	TimeOut_t sTO;
+	if (bISR == 0)
+		vTaskSetTimeOutState(&sTO);
+	u32_t State = __atomic_load_n(&psRW->State, __ATOMIC_ACQUIRE);
+	while (1) {
+		if ((State & Block) == 0) {
+			IF_myASSERT(debugTRACK, (State & rwREADERS) < rwREADERS);
+			if (__atomic_compare_exchange_n(&psRW->State, &State, State + 1, 1, __ATOMIC_ACQUIRE, __ATOMIC_ACQUIRE))
+				break;
+			continue;									// State refreshed by failed CAS
+		}
+		if (bISR || tWait == 0 || xTaskCheckForTimeOut(&sTO, &tWait) == pdTRUE)
+			return pdFALSE;
+		bWaited = 1;
+		if (xRtosSemaphoreTake(&psRW->shWriter, tWait) == pdFALSE)
+			return pdFALSE;
+		xRtosSemaphoreGive(&psRW->shWriter);			// writer done, release and retry
+		State = __atomic_load_n(&psRW->State, __ATOMIC_ACQUIRE);
+	}
+	__atomic_fetch_add(&psRW->ReadTakes, 1, __ATOMIC_RELAXED);
+	if (bWaited)
+		__atomic_fetch_add(&psRW->ReadWaits, 1, __ATOMIC_RELAXED);
+	return pdTRUE;
+}
+
+BaseType_t xRtosRWLockGiveRead(rtos_rwlock_t * psRW) {
+	if (xTaskGetSchedulerState() != taskSCHEDULER_RUNNING || psRW->Init != rwINIT_DONE)
+		return pdFALSE;
+	u32_t State = __atomic_fetch_sub(&psRW->State, 1, __ATOMIC_RELEASE);
+	IF_myASSERT(debugTRACK, (State & rwREADERS) != 0);
+	if (((State & rwREADERS) == 1) && (State & rwW_PEND)) {	// last reader out, writer waiting
+		BaseType_t btHPTwoken = pdFALSE;
+		if (halNVIC_CalledFromISR()) {
+			xSemaphoreGiveFromISR(psRW->shDrain, &btHPTwoken);
+			if (btHPTwoken == pdTRUE)
+				portYIELD_FROM_ISR();
+		} else {
+			xSemaphoreGive(psRW->shDrain);
+		}
+	}
+	return pdTRUE;
+}
+
+BaseType_t xRtosRWLockTakeWrite(rtos_rwlock_t * psRW, TickType_t tWait) {
+	// step 1: if scheduler not (yet) running, fake a result...
+	if (xTaskGetSchedulerState() != taskSCHEDULER_RUNNING)
+		return pdFALSE;
+	IF_myASSERT(debugTRACK, halNVIC_CalledFromISR() == 0);
+	if (halNVIC_CalledFromISR())
+		return pdFALSE;									// writers can block, not allowed from ISR
+	// step 2: if not initialised, do so now
+	if (psRW->Init != rwINIT_DONE)
+		vRtosRWLockInit(psRW);
+	// step 3: become the only writer, flag as pending to hold off new readers
+	TimeOut_t sTO;
+	vTaskSetTimeOutState(&sTO);
+	if (xRtosSemaphoreTake(&psRW->shWriter, tWait) == pdFALSE)
+		return pdFALSE;
+	__atomic_fetch_or(&psRW->State, rwW_PEND, __ATOMIC_ACQ_REL);
+	// step 4: wait for active readers to drain
+	bool bWaited = 0;
+	while (1) {
+		u32_t State = __atomic_load_n(&psRW->State, __ATOMIC_ACQUIRE);
+		if ((State & rwREADERS) == 0) {
+			if (__atomic_compare_exchange_n(&psRW->State, &State, State | rwW_ACTIVE, 0, __ATOMIC_ACQUIRE, __ATOMIC_RELAXED))
+				break;
+			continue;
+		}
+		if (xTaskCheckForTimeOut(&sTO, &tWait) == pdTRUE) {	// timed out, back out
+			__atomic_fetch_and(&psRW->State, ~rwW_PEND, __ATOMIC_RELEASE);
+			xRtosSemaphoreGive(&psRW->shWriter);
+			return pdFALSE;
+		}
+		bWaited = 1;
+		xSemaphoreTake(psRW->shDrain, tWait);			// woken by last reader out (or stale), recheck
+	}
+	++psRW->WriteTakes;									// serialised by shWriter
+	if (bWaited)
+		++psRW->WriteWaits;
+	return pdTRUE;
+}
+
+BaseType_t xRtosRWLockGiveWrite(rtos_rwlock_t * psRW) {
+	if (xTaskGetSchedulerState() != taskSCHEDULER_RUNNING || psRW->Init != rwINIT_DONE)
+		return pdFALSE;
+	IF_myASSERT(debugTRACK, psRW->State & rwW_ACTIVE);
+	__atomic_fetch_and(&psRW->State, ~(rwW_ACTIVE | rwW_PEND), __ATOMIC_RELEASE);
+	return xRtosSemaphoreGive(&psRW->shWriter);		// wakes next writer or waiting readers
+}
+
+void vRtosRWLockDelete(rtos_rwlock_t * psRW) {
+	if (psRW->Init != rwINIT_DONE)
+		return;
+	IF_myASSERT(debugTRACK, psRW->State == 0);
+	vSemaphoreDelete(psRW->shDrain);
+	vRtosSemaphoreDelete(&psRW->shWriter);
+	psRW->shDrain = NULL;
+	psRW->State = psRW->ReadTakes = psRW->ReadWaits = psRW->WriteTakes = psRW->WriteWaits = 0;
+	__atomic_store_n(&psRW->Init, rwINIT_NONE, __ATOMIC_RELEASE);
+}
+
+int xRtosReportRWLock(report_t * psR, rtos_rwlock_t * psRW, const char * pcName) {
+	u32_t State = psRW->State;
+	int iRV = xReport(psR, "%C%s%C\t%p  R=%lu  W=%c%c  Reads=%lu/%lu  Writes=%lu/%lu  %s", xpfCOL(colourFG_CYAN,0),
+		pcName, xpfCOL(attrRESET,0), psRW->shWriter, State & rwREADERS, (State & rwW_PEND) ? 'P' : '-',
+		(State & rwW_ACTIVE) ? 'A' : '-', psRW->ReadWaits, psRW->ReadTakes, psRW->WriteWaits, psRW->WriteTakes,
+		psRW->bReaderPref ? "ReadPref" : "WritePref");
+	if (fmTST(aNL))
+		iRV += xReport(psR, strNL);
+	return iRV;
+}
+
+// ################################# Task notification signalling ##################################
+
+#if (rtosSIGNAL > 0)
+
+static BaseType_t SignalYield[portNUM_PROCESSORS] = { 0 };	// per core, yield pending on ISR exit
+
+void vRtosSignalInit(rtos_signal_t * psSig, TaskHandle_t thTask, u32_t Mask) {
+	IF_myASSERT(debugPARAM, Mask != 0);
+	memset(psSig, 0, sizeof(rtos_signal_t));
+	psSig->thTask = thTask ? thTask : xTaskGetCurrentTaskHandle();
+	psSig->Mask = Mask;
+}
+
+BaseType_t xRtosSignalSet(rtos_signal_t * psSig, u32_t Count) {
+	if (psSig->thTask == NULL)
+		return pdFALSE;									// not (yet) initialised
+	if (Count)
+		__atomic_fetch_add(&psSig->Count, Count, __ATOMIC_RELAXED);
+	__atomic_fetch_add(&psSig->Sets, 1, __ATOMIC_RELAXED);
+	u64_t tZero = 0ULL;									// stamp only first SET, coalesced SETs keep oldest
+	__atomic_compare_exchange_n(&psSig->tSet, &tZero, rtosRT_NOW(), 0, __ATOMIC_RELEASE, __ATOMIC_RELAXED);
+	if (halNVIC_CalledFromISR()) {
+		BaseType_t btHPTwoken = pdFALSE;
+		BaseType_t btRV = xTaskNotifyIndexedFromISR(psSig->thTask, rtosSIGNAL_INDEX, psSig->Mask, eSetBits, &btHPTwoken);
+		if (btHPTwoken == pdTRUE)
+			SignalYield[esp_cpu_get_core_id()] = pdTRUE;	// defer, yield once on ISR exit
+		return btRV;
+	}
+	return xTaskNotifyIndexed(psSig->thTask, rtosSIGNAL_INDEX, psSig->Mask, eSetBits);
+}
+
+void vRtosSignalISRExit(void) {
+	int Core = esp_cpu_get_core_id();
+	if (SignalYield[Core] == pdTRUE) {
+		SignalYield[Core] = pdFALSE;
+		portYIELD_FROM_ISR();
+	}
+}
+
+u32_t xRtosSignalWait(rtos_signal_t * psSig[], int Num, TickType_t tW) {
+	IF_myASSERT(debugPARAM, halNVIC_CalledFromISR() == 0);
+	u32_t Mask = 0, Bits;
+	for (int i = 0; i < Num; ++i)
+		Mask |= psSig[i]->Mask;
+	TimeOut_t sTO;
+	vTaskSetTimeOutState(&sTO);
+	while (1) {
+		// atomically read & clear only our bits, bits of other signals remain pending
+		Bits = ulTaskNotifyValueClearIndexed(NULL, rtosSIGNAL_INDEX, Mask) & Mask;
+		if (Bits || xTaskCheckForTimeOut(&sTO, &tW) == pdTRUE)
+			break;
+		// block until any notification, a SET between the clear and here leaves the state pending
+		xTaskNotifyWaitIndexed(rtosSIGNAL_INDEX, 0, 0, NULL, tW);
+	}
+	if (Bits == 0)
+		return 0;
+	u64_t tNow = rtosRT_NOW();
+	for (int i = 0; i < Num; ++i) {
+		rtos_signal_t * psS = psSig[i];
+		if ((Bits & psS->Mask) == 0)
+			continue;
+		u64_t tSet = __atomic_exchange_n(&psS->tSet, 0ULL, __ATOMIC_ACQUIRE);
+		if (tSet == 0ULL || tSet > tNow)
+			continue;
+		u64_t tLat = tNow - tSet;						// only this task updates latency stats
+		++psS->Wakes;
+		psS->tLatSum += tLat;
+		if (tLat > psS->tLatMax)
+			psS->tLatMax = tLat;
+		vRtosHistAdd(&psS->sLat, tLat);
+	}
+	return Bits;
+}
+
+u32_t xRtosSignalCount(rtos_signal_t * psSig) { return __atomic_exchange_n(&psSig->Count, 0, __ATOMIC_ACQ_REL); }
+
+int xRtosReportSignal(report_t * psR, rtos_signal_t * psSig, const char * pcName) {
+	int iRV = xReport(psR, "%C%s%C\t0x%08lX  Set=%lu  Wake=%lu  Lavg=%llu  Lmax=%llu", xpfCOL(colourFG_CYAN,0), pcName,
+		xpfCOL(attrRESET,0), psSig->Mask, psSig->Sets, psSig->Wakes,
+		psSig->Wakes ? psSig->tLatSum / psSig->Wakes : 0ULL, psSig->tLatMax);
+	if (psR->sFM.bXtras) {
+		iRV += xReport(psR, strNL);
+		iRV += xRtosHistReport(psR, "Lat", &psSig->sLat);
+	} else if (fmTST(aNL)) {
+		iRV += xReport(psR, strNL);
+	}
+	return iRV;
+}
+
+#endif
+
 // ################################### Task status reporting #######################################
 
 #if		(CONFIG_FREERTOS_MAX_TASK_NAME_LEN == 16)
@@ -226,194 +1608,2019 @@ BaseType_t xRtosSemaphoreCheckCurrent(SemaphoreHandle_t * pSH) {
 #endif
 
 static u64rt_t Active = { 0 };							// Sum non-IDLE tasks
-static u8_t NumTasks = 0;								// Currently "active" tasks
-static u8_t MaxNum = 0;									// Highest logical task number
 
 static const char TaskState[6] = { 'A', 'R', 'B', 'S', 'D', 'I' };
 static TaskHandle_t IdleHandle[portNUM_PROCESSORS] = { 0 };
-// table where task status is stored when xRtosReportTasks() is called, avoid alloc/free
-static TaskStatus_t	sTS[configFR_MAX_TASKS] = { 0 };
 #if	(portNUM_PROCESSORS > 1)
 	static const char caMCU[3] = { '0', '1', 'X' };
 	static u64rt_t Cores[portNUM_PROCESSORS+1];			// Sum of non-IDLE task runtime/core
-	static SemaphoreHandle_t shTaskInfo;
 #endif
 
-static TaskStatus_t * psRtosStatsFindWithNumber(UBaseType_t xTaskNumber) {
-	IF_myASSERT(debugPARAM, xTaskNumber != 0);
-	for (int t = 0; t <= NumTasks; ++t) {
-		if (sTS[t].xTaskNumber == xTaskNumber)
-			return &sTS[t];
+/* Task status snapshots, sorted on xTaskNumber. A capture buffer is claimed (like the render buffers) by
+ * psRtosStatsSnapshot() and owned by the caller until vRtosStatsRelease(), so the interval hook and
+ * reports never share one. Each buffer holds the task status entries, the task list and a copy of every
+ * task name, so a snapshot stays valid even if tasks are deleted while it is rendered. Buffers come from
+ * the heap, rtosSTATS_RESERVE entries on first use, and are grown (and kept) once more tasks exist. If
+ * a larger buffer is not available the tasks that fit are captured and the rest counted in Omit. */
+typedef struct rtos_snap_t {
+	TaskStatus_t * sTS;									// pcTaskName points into caName[]
+	TaskSnapshot_t * psList;							// tasks found, in kernel list order
+	char (* caName)[CONFIG_FREERTOS_MAX_TASK_NAME_LEN];
+	UBaseType_t Max;									// entries allocated
+	UBaseType_t Num;									// tasks captured
+	UBaseType_t Omit;									// tasks that did not fit
+	u64_t Total;										// runtime counter total
+} rtos_snap_t;
+
+#define statsENTRY_SIZE		(sizeof(TaskStatus_t) + sizeof(TaskSnapshot_t) + CONFIG_FREERTOS_MAX_TASK_NAME_LEN)
+
+static rtos_snap_t sSnap[rtosSTATS_SLOTS] = { 0 };
+static u8_t SnapBusy[rtosSTATS_SLOTS] = { 0 };
+#if (portNUM_PROCESSORS > 1) && (cmakeWRAP_TASKS == 1)
+	/* The scheduler is only suspended on the capturing core, a task deleted from the other core could
+	 * be freed while its TCB is read. Captures and (wrapped) deletes of other tasks exclude each other,
+	 * tasks deleting themselves are reclaimed later by the IDLE task as before. */
+	static u8_t SnapCapture = 0, SnapDelete = 0;		// captures & deletes in progress
+	static portMUX_TYPE muxSnap = portMUX_INITIALIZER_UNLOCKED;
+#endif
+
+/* Interval statistics. bRtosStatsUpdateHook() keeps the runtime counter of each task from the previous
+ * sample and the delta (or EWMA of deltas) over the last interval, sorted on xTaskNumber like the
+ * snapshot so both can be walked in step. Only the hook writes, into the spare table which is then
+ * swapped in under muxStats, xRtosReportTasks() reads individual entries under muxStats. Both tables
+ * are allocated when interval sampling is first used and grown with the capture buffers. */
+typedef struct stats_win_t {
+	UBaseType_t xTaskNumber;
+	u64_t tPrev;										// runtime counter at previous sample
+	u64_t tRun;											// runtime during last interval (or EWMA)
+} stats_win_t;
+
+static stats_win_t * sWin = NULL, * sWinNext = NULL;
+static UBaseType_t NumWin = 0, WinMax = 0;
+static u64_t WinTotalPrev = 0, WinTotal = 0;			// total runtime, previous & last interval
+static TickType_t WinLast = 0;							// tick count at last sample
+static u8_t StatsMode = rtosUTIL_CUMULATIVE, WinSamples = 0, WinBusy = 0;
+static u8_t StatsAlpha = rtosSTATS_ALPHA;
+static u16_t StatsWindow = rtosSTATS_WINDOW;
+static portMUX_TYPE muxStats = portMUX_INITIALIZER_UNLOCKED;
+
+static int xRtosStatsCompare(const void * pvA, const void * pvB) {
+	UBaseType_t A = ((const TaskStatus_t *) pvA)->xTaskNumber, B = ((const TaskStatus_t *) pvB)->xTaskNumber;
+	return (A > B) - (A < B);
+}
+
+#if (portNUM_PROCESSORS > 1) && (cmakeWRAP_TASKS == 1)
+/**
+ * @brief		wait (a tick at a time) until no opposing operation is in progress, then count one more
+ * @param[in]	pOwn pointer to counter of own operations in progress
+ * @param[in]	pOther pointer to counter of operations excluded
+ */
+static void vRtosStatsGateEnter(u8_t * pOwn, u8_t * pOther) {
+	while (1) {
+		taskENTER_CRITICAL(&muxSnap);
+		bool bFree = (*pOther == 0);
+		if (bFree)
+			++*pOwn;
+		taskEXIT_CRITICAL(&muxSnap);
+		if (bFree)
+			return;
+		vTaskDelay(1);
+	}
+}
+
+static void vRtosStatsGateExit(u8_t * pOwn) {
+	taskENTER_CRITICAL(&muxSnap);
+	--*pOwn;
+	taskEXIT_CRITICAL(&muxSnap);
+}
+#endif
+
+/**
+ * @brief		release ownership of a snapshot (capture buffer)
+ * @param[in]	psSnap pointer to snapshot as returned by psRtosStatsSnapshot()
+ */
+static void vRtosStatsRelease(rtos_snap_t * psSnap) {
+	int Idx = psSnap - &sSnap[0];
+	IF_myASSERT(debugPARAM, INRANGE(0, Idx, rtosSTATS_SLOTS - 1));
+	__atomic_store_n(&SnapBusy[Idx], 0, __ATOMIC_RELEASE);
+}
+
+/**
+ * @brief		make sure a capture buffer can hold a number of tasks
+ * @param[in]	psSnap pointer to snapshot owned by the caller
+ * @param[in]	Need number of entries required
+ * @return		1 if sufficient, 0 if the heap could not provide a larger buffer (existing one kept)
+ */
+static bool bRtosStatsGrow(rtos_snap_t * psSnap, UBaseType_t Need) {
+	if (Need <= psSnap->Max)
+		return 1;
+	if (Need < rtosSTATS_RESERVE)
+		Need = rtosSTATS_RESERVE;
+	else if (psSnap->Max)
+		Need += rtosSTATS_GROW;							// headroom, avoid growing a task at a time
+	u8_t * pu8Buf = pvPortMalloc(Need * statsENTRY_SIZE);
+	if (pu8Buf == NULL)
+		return 0;
+	vPortFree(psSnap->sTS);								// single allocation, status entries first
+	psSnap->sTS = (TaskStatus_t *) pu8Buf;
+	psSnap->psList = (TaskSnapshot_t *) (pu8Buf + Need * sizeof(TaskStatus_t));
+	psSnap->caName = (void *) (pu8Buf + Need * (sizeof(TaskStatus_t) + sizeof(TaskSnapshot_t)));
+	psSnap->Max = Need;
+	return 1;
+}
+
+/**
+ * @brief		claim a capture buffer and take a self contained snapshot of all tasks, sorted on xTaskNumber
+ * @return		pointer to snapshot, owned by the caller until vRtosStatsRelease(), Omit > 0 if not all
+ * 				tasks could be captured, NULL if no capture buffer could be allocated at all
+ * @note		task context only, waits (a tick at a time) while all capture buffers are owned
+ */
+static rtos_snap_t * psRtosStatsSnapshot(void) {
+	rtos_snap_t * psSnap = NULL;
+	while (1) {
+		for (int i = 0; i < rtosSTATS_SLOTS; ++i) {
+			u8_t Free = 0;
+			if (__atomic_compare_exchange_n(&SnapBusy[i], &Free, 1, 0, __ATOMIC_ACQUIRE, __ATOMIC_RELAXED)) {
+				psSnap = &sSnap[i];
+				break;
+			}
+		}
+		if (psSnap)
+			break;
+		vTaskDelay(1);
+	}
+#if (portNUM_PROCESSORS > 1) && (cmakeWRAP_TASKS == 1)
+	vRtosStatsGateEnter(&SnapCapture, &SnapDelete);
+#endif
+	UBaseType_t Live;
+	for (int Try = 0; Try < 2; ++Try) {					// grow & retry once if tasks were created meanwhile
+		bRtosStatsGrow(psSnap, uxTaskGetNumberOfTasks());	// on failure capture what fits
+		vTaskSuspendAll();								// no task created or freed until names copied
+		Live = uxTaskGetNumberOfTasks();
+		if (Live <= psSnap->Max || Try == 1 || psSnap->Max == 0)
+			break;
+		xTaskResumeAll();
+	}
+	UBaseType_t TCBSize;
+	psSnap->Num = psSnap->Max ? uxTaskGetSnapshotAll(psSnap->psList, psSnap->Max, &TCBSize) : 0;
+	for (UBaseType_t t = 0; t < psSnap->Num; ++t) {
+		TaskStatus_t * psTS = &psSnap->sTS[t];
+		TaskHandle_t xHandle = (TaskHandle_t) psSnap->psList[t].pxTCB;
+#if (rtosSCAN_MAX > 0) && (cmakeWRAP_TASKS == 1)
+		u32_t Free = xRtosStackFree(xHandle);			// cached by the scanner, no stack walk
+		vTaskGetInfo(xHandle, psTS, (Free == UINT32_MAX) ? pdTRUE : pdFALSE, eInvalid);
+		if (Free != UINT32_MAX)
+			psTS->usStackHighWaterMark = Free / sizeof(StackType_t);
+#else
+		vTaskGetInfo(xHandle, psTS, pdTRUE, eInvalid);
+#endif
+		memcpy(psSnap->caName[t], psTS->pcTaskName, CONFIG_FREERTOS_MAX_TASK_NAME_LEN);
+		psTS->pcTaskName = psSnap->caName[t];
+	}
+	psSnap->Total = rtosRT_NOW();
+	psSnap->Omit = (Live > psSnap->Num) ? Live - psSnap->Num : 0;	// list includes tasks awaiting IDLE cleanup
+	xTaskResumeAll();
+#if (portNUM_PROCESSORS > 1) && (cmakeWRAP_TASKS == 1)
+	vRtosStatsGateExit(&SnapCapture);
+#endif
+	if (psSnap->Max == 0) {								// no buffer at all
+		vRtosStatsRelease(psSnap);
+		return NULL;
+	}
+	qsort(psSnap->sTS, psSnap->Num, sizeof(TaskStatus_t), xRtosStatsCompare);
+	return psSnap;
+}
+
+/**
+ * @brief		update interval runtime of all tasks from the snapshot just taken
+ * @param[in]	psSnap pointer to snapshot, owned by the caller
+ */
+static void vRtosStatsWindowUpdate(rtos_snap_t * psSnap) {
+	if (psSnap->Num > WinMax) {							// first use or more tasks, (re)allocate both tables
+		stats_win_t * psNext = pvPortMalloc(psSnap->Max * sizeof(stats_win_t));
+		stats_win_t * psLive = pvPortMalloc(psSnap->Max * sizeof(stats_win_t));
+		if (psNext == NULL || psLive == NULL) {			// skip this interval, last one still reported
+			vPortFree(psNext);
+			vPortFree(psLive);
+			return;
+		}
+		if (NumWin)										// single writer, content stable
+			memcpy(psLive, sWin, NumWin * sizeof(stats_win_t));
+		taskENTER_CRITICAL(&muxStats);
+		stats_win_t * psOld = sWin;
+		sWin = psLive;
+		taskEXIT_CRITICAL(&muxStats);
+		vPortFree(psOld);
+		vPortFree(sWinNext);
+		sWinNext = psNext;
+		WinMax = psSnap->Max;
+	}
+	// both tables sorted on task number, single merge pass, deleted tasks drop out
+	UBaseType_t i = 0;
+	for (UBaseType_t t = 0; t < psSnap->Num; ++t) {
+		TaskStatus_t * psTS = &psSnap->sTS[t];
+		stats_win_t * psW = &sWinNext[t];
+		psW->xTaskNumber = psTS->xTaskNumber;
+		psW->tPrev = psTS->ulRunTimeCounter;
+		u64_t tPrev = 0ULL, tRun = 0ULL;				// new task, all runtime in this interval
+		bool bFound = 0;
+		while (i < NumWin && sWin[i].xTaskNumber < psTS->xTaskNumber)
+			++i;
+		if (i < NumWin && sWin[i].xTaskNumber == psTS->xTaskNumber) {
+			tPrev = sWin[i].tPrev;
+			tRun = sWin[i].tRun;
+			bFound = 1;
+		}
+		u64_t tDelta = psW->tPrev - tPrev;
+		psW->tRun = (StatsMode == rtosUTIL_EWMA && bFound && WinSamples > 1) ?
+					(tDelta * StatsAlpha + tRun * (100 - StatsAlpha)) / 100ULL : tDelta;
+	}
+	u64_t tDelta = psSnap->Total - WinTotalPrev;
+	taskENTER_CRITICAL(&muxStats);
+	stats_win_t * psTmp = sWin;
+	sWin = sWinNext;
+	sWinNext = psTmp;
+	NumWin = psSnap->Num;
+	WinTotal = (StatsMode == rtosUTIL_EWMA && WinSamples > 1) ?
+				(tDelta * StatsAlpha + WinTotal * (100 - StatsAlpha)) / 100ULL : tDelta;
+	WinTotalPrev = psSnap->Total;
+	taskEXIT_CRITICAL(&muxStats);
+	if (WinSamples < 2)
+		++WinSamples;
+}
+
+/**
+ * @brief		find the runtime of a task during the last interval
+ * @param[in]	xTaskNumber task number
+ * @param[in/out]	pCursor position to start searching from, tasks must be looked up in ascending order
+ * @return		runtime, 0 if task not present at last sample
+ */
+static u64_t xRtosStatsWindowRun(UBaseType_t xTaskNumber, UBaseType_t * pCursor) {
+	u64_t tRun = 0ULL;
+	taskENTER_CRITICAL(&muxStats);
+	UBaseType_t i = *pCursor;
+	while (i < NumWin && sWin[i].xTaskNumber < xTaskNumber)
+		++i;
+	if (i < NumWin && sWin[i].xTaskNumber == xTaskNumber)
+		tRun = sWin[i].tRun;
+	taskEXIT_CRITICAL(&muxStats);
+	*pCursor = i;
+	return tRun;
+}
+
+void vRtosStatsSetMode(int Mode, u32_t Window, u32_t Alpha) {
+	IF_myASSERT(debugPARAM, INRANGE(rtosUTIL_CUMULATIVE, Mode, rtosUTIL_EWMA));
+	StatsMode = Mode;
+	if (Window)
+		StatsWindow = Window;
+	if (INRANGE(1, Alpha, 100))
+		StatsAlpha = Alpha;
+	WinSamples = 0;										// restart, first sample only sets baseline
+	WinLast = 0;
+}
+
+bool bRtosStatsUpdateHook(void) {
+	if (StatsMode == rtosUTIL_CUMULATIVE)
+		return 0;
+	TickType_t tNow = xTaskGetTickCount();
+	if (WinSamples && (tNow - WinLast) < pdMS_TO_TICKS(StatsWindow * 1000UL))
+		return 0;
+	WinLast = tNow;
+	u8_t Free = 0;										// window tables have a single writer
+	if (__atomic_compare_exchange_n(&WinBusy, &Free, 1, 0, __ATOMIC_ACQUIRE, __ATOMIC_RELAXED)) {
+		rtos_snap_t * psSnap = psRtosStatsSnapshot();
+		if (psSnap) {
+			vRtosStatsWindowUpdate(psSnap);
+			vRtosStatsRelease(psSnap);
+		}
+		__atomic_store_n(&WinBusy, 0, __ATOMIC_RELEASE);
+	}
+#if defined(CONFIG_HEAP_TASK_TRACKING)
+	vRtosHeapSample();									// keep per task heap peaks up to date
+#endif
+#if (cmakeWRAP_TIMERS == 1)
+	vRtosTimerProbe();
+#endif
+	return 1;
+}
+
+bool bRtosTaskIsIdleTask(TaskHandle_t xHandle) {
+	for (int c = 0; c < portNUM_PROCESSORS; ++c) {
+		 if (xHandle == IdleHandle[c])
+		 	return 1;
+	}
+	return 0;
+}
+
+int	xRtosReportTasks(report_t * psR) {
+	if (psR == NULL || psR->sFM.u32Val == 0)
+		return erINV_PARA;
+	if (IdleHandle[0] == NULL) {						// first time once only
+		for (int c = 0; c < portNUM_PROCESSORS; ++c)
+			IdleHandle[c] = xTaskGetIdleTaskHandleForCore(c);
+	}
+	bool bWin = (StatsMode != rtosUTIL_CUMULATIVE);
+	if (bWin && WinSamples < 2)							// use last interval rather than since boot
+		return xReport(psR, "Utilisation interval not yet sampled" strNL);
+	rtos_snap_t * psSnap = psRtosStatsSnapshot();		// Get up-to-date task status
+	if (psSnap == NULL)
+		return xReport(psR, "No memory for task snapshot" strNL);
+	u64_t TotalAdj;
+	u64_t TotalRem = psSnap->Total;						// Used to calculate RTOS internal use
+	if (bWin) {
+		taskENTER_CRITICAL(&muxStats);
+		TotalRem = WinTotal;
+		taskEXIT_CRITICAL(&muxStats);
+	}
+
+	TotalRem *= portNUM_PROCESSORS;						// Adjust overhead for all cores
+	TotalAdj = TotalRem / 100ULL;						// will be used to calc % for each task...
+	
+	if (TotalAdj == 0ULL) {
+		vRtosStatsRelease(psSnap);
+		return 0;
+	}
+	Active.U64val = 0;									// reset overall active running total
+#if (portNUM_PROCESSORS > 1)
+	memset(&Cores[0], 0, sizeof(Cores));				// reset time/core running totals
+#endif
+	// Snapshot captured, now render into memory, console only locked while emitting the result
+	rtos_render_t sRB;
+	if (xRtosRenderStart(&sRB, psR) != erSUCCESS) {
+		vRtosStatsRelease(psSnap);
+		return erFAILURE;
+	}
+	if (psR->sFM.bTskNum)			vRtosRenderAdd(&sRB, "T# ");
+	if (psR->sFM.bPrioX)			vRtosRenderAdd(&sRB, "Pc/Pb ");
+	vRtosRenderAdd(&sRB, configFREERTOS_TASKLIST_HDR_DETAIL);
+	if (psR->sFM.bState)			vRtosRenderAdd(&sRB, "S ");
+	if (psR->sFM.bStack)			vRtosRenderAdd(&sRB, "LowS ");
+#if (portNUM_PROCESSORS > 1)
+	if (psR->sFM.bCore)				vRtosRenderAdd(&sRB, "X ");
+#endif
+	vRtosRenderAdd(&sRB, " Util Ticks");
+#if (rtosWAKE > 0)
+	vRtosRenderAdd(&sRB, "   Wavg   Wmax");
+#endif
+	if (debugTRACK && psR->sFM.bXtras) vRtosRenderAdd(&sRB, "|Stack Base|-Task TCB-|   LSP    |");
+	vRtosRenderHeader(&sRB);
+	vRtosRenderAdd(&sRB, strNL);
+
+	u32_t Units, Fracts, TaskMask;
+	UBaseType_t Cursor = 0;
+	char caTicks[28];
+	// display individual task info, table already sorted on task number
+	for (int a = 0; a < psSnap->Num; ++a) {
+		TaskStatus_t * psTS = &psSnap->sTS[a];
+		// mask selects tasks 1->32, higher numbered tasks are always shown
+		TaskMask = (psTS->xTaskNumber <= 32) ? (1UL << (psTS->xTaskNumber - 1)) : 0xFFFFFFFF;
+		if ((psTS->eCurrentState >= eInvalid) || ((psR->sFM.uCount & TaskMask) == 0) ||
+			(psTS->uxCurrentPriority >= (UBaseType_t) configMAX_PRIORITIES) || (psTS->uxBasePriority >= configMAX_PRIORITIES)) {
+			continue;
+		}
+		// Check for invalid Core ID, often happens in process of shutting down tasks.
+		if ((rtosTS_CORE(psTS) != tskNO_AFFINITY) &&
+			INRANGE(0, rtosTS_CORE(psTS), portNUM_PROCESSORS-1) == 0) {
+			vRtosRenderAdd(&sRB, "%u CoreID=%d skipped !!!" strNL, (unsigned) psTS->xTaskNumber, (int) rtosTS_CORE(psTS));
+			continue;
+		}
+		if (psR->sFM.bTskNum)		vRtosRenderAdd(&sRB, "%2u ", (unsigned) psTS->xTaskNumber);
+		if (psR->sFM.bPrioX)		vRtosRenderAdd(&sRB, "%2u/%2u ", (unsigned) psTS->uxCurrentPriority, (unsigned) psTS->uxBasePriority);
+		vRtosRenderAdd(&sRB, configFREERTOS_TASKLIST_FMT_DETAIL, psTS->pcTaskName);
+		if (psR->sFM.bState)		vRtosRenderAdd(&sRB, "%c ", TaskState[psTS->eCurrentState]);
+		if (psR->sFM.bStack)		vRtosRenderAdd(&sRB, "%4lu ", (unsigned long) psTS->usStackHighWaterMark);
+	#if (portNUM_PROCESSORS > 1)
+		int c = (rtosTS_CORE(psTS) == tskNO_AFFINITY) ? 2 : rtosTS_CORE(psTS);
+		if (psR->sFM.bCore)		vRtosRenderAdd(&sRB, "%c ", caMCU[c]);
+	#endif
+		u64_t tRun = bWin ? xRtosStatsWindowRun(psTS->xTaskNumber, &Cursor) : psTS->ulRunTimeCounter;
+		TotalRem -= tRun;								// Adjust overhead for this task
+		// Calculate & display individual task utilisation.
+		Units = tRun / TotalAdj;
+		Fracts = (((tRun * 100) / TotalAdj) + 50) % 100;
+		vRtosRenderAdd(&sRB, "%2lu.%02lu %5s", (unsigned long) Units, (unsigned long) Fracts, pcRtosU64Group(caTicks, tRun));
+	#if (rtosWAKE > 0)
+		u64_t tWmax, tWavg = xRtosWakeTaskLatency(psTS->xHandle, &tWmax);
+		vRtosRenderAdd(&sRB, " %6llu %6llu", (unsigned long long) tWavg, (unsigned long long) tWmax);
+	#endif
+	#if (debugTRACK)
+		if (debugTRACK && psR->sFM.bXtras) {
+			vRtosRenderAdd(&sRB, " %p %p", pxTaskGetStackStart(psTS->xHandle), psTS->xHandle);
+			vRtosRenderAdd(&sRB, " %p", pvTaskGetThreadLocalStoragePointer(psTS->xHandle, 1));
+		}
+	#endif
+		if (psR->sFM.bNL)			vRtosRenderAdd(&sRB, strNL);
+		// For idle task(s) we do not want to add RunTime % to the task or Core RunTime
+		if (bRtosTaskIsIdleTask(psTS->xHandle) == 0) {	// NOT an IDLE task
+			Active.U64val += tRun;						// Update total active time
+		#if (portNUM_PROCESSORS > 1)
+			Cores[c].U64val += tRun;					// Update core active time
+		#endif
+		}
+	}
+
+	Units = Active.U64val / TotalAdj;	// Calculate & display total for "real" tasks utilization.
+	Fracts = ((Active.U64val * 100) / TotalAdj) % 100;
+#if	(portNUM_PROCESSORS > 1)
+	vRtosRenderAdd(&sRB, "%u Tasks %lu.%02lu%% [", (unsigned) psSnap->Num, (unsigned long) Units, (unsigned long) Fracts);
+	for(int c = 0; c <= portNUM_PROCESSORS; ++c) {
+		Units = Cores[c].U64val / TotalAdj;
+		Fracts = ((Cores[c].U64val * 100) / TotalAdj) % 100;
+		vRtosRenderAdd(&sRB, "%c=%lu.%02lu%c", caMCU[c], (unsigned long) Units, (unsigned long) Fracts, c < 2 ? ' ' : ']');
+	}
+#else
+	vRtosRenderAdd(&sRB, "%u Tasks %lu.%02lu%%", (unsigned) psSnap->Num, (unsigned long) Units, (unsigned long) Fracts);
+#endif
+	// Display remaining ticks as RTOS overhead.
+	Units = TotalRem / TotalAdj;
+	Fracts = ((TotalRem * 100) / TotalAdj) % 100;
+	vRtosRenderAdd(&sRB, " RTOS %lu.%02lu%%", (unsigned long) Units, (unsigned long) Fracts);
+	if (bWin)
+		vRtosRenderAdd(&sRB, StatsMode == rtosUTIL_EWMA ? " (EWMA %us a=%u%%)" : " (last %us)", StatsWindow, StatsAlpha);
+	if (xRtosTaskMaskFailures())
+		vRtosRenderAdd(&sRB, " MaskFail=%lu", (unsigned long) xRtosTaskMaskFailures());
+	if (psSnap->Omit)
+		vRtosRenderAdd(&sRB, " (%u tasks omitted, no memory)", (unsigned) psSnap->Omit);
+	// all done...
+	vRtosRenderAdd(&sRB, psR->sFM.bNL ? strNLx2 : strNL);
+	vRtosStatsRelease(psSnap);
+	return xRtosRenderEnd(&sRB);
+}
+
+/**
+ * @brief		find status of task in a snapshot
+ * @param[in]	psSnap pointer to snapshot, owned by the caller, can be NULL
+ * @param[in]	xHandle task handle
+ * @return		pointer to task status or NULL if not found (deleted)
+ */
+static __attribute__((unused)) TaskStatus_t * psRtosStatsFindWithHandle(rtos_snap_t * psSnap, TaskHandle_t xHandle) {
+	for (int t = 0; psSnap && t < psSnap->Num; ++t) {
+		if (psSnap->sTS[t].xHandle == xHandle)
+			return &psSnap->sTS[t];
+	}
+	return NULL;
+}
+
+#if (rtosSEMA_PROFILE > 0)
+/**
+ * @brief		find name of task in a snapshot
+ * @param[in]	psSnap pointer to snapshot, owned by the caller, can be NULL
+ * @param[in]	xHandle task handle
+ * @return		pointer to task name, "?" if task not found (deleted) and "-" if no handle
+ */
+static const char * pcRtosStatsNameWithHandle(rtos_snap_t * psSnap, TaskHandle_t xHandle) {
+	if (xHandle == NULL)
+		return "-";
+	TaskStatus_t * psTS = psRtosStatsFindWithHandle(psSnap, xHandle);
+	return psTS ? psTS->pcTaskName : "?";
+}
+
+int xRtosReportSemaphores(report_t * psR) {
+	rtos_snap_t * psSnap = psRtosStatsSnapshot();		// used to map holder handles to names, "?" if no memory
+	int iRV = xReport(psR, "%C%-10s  Takes   Cont    T/O   Wavg   Wmax   Havg   Hmax Last Holder      Top Holder%C" strNL,
+					xpfCOL(colourFG_CYAN,0), "Semaphore", xpfCOL(attrRESET,0));
+	sema_prof_t sSP;
+	for (int i = 0; i < rtosSEMA_PROF_MAX; ++i) {
+		if (sSemaProf[i].shSema == NULL)
+			continue;
+		memcpy(&sSP, &sSemaProf[i], sizeof(sema_prof_t));	// work on a copy, values are live
+		int iTop = 0;
+		for (int j = 1; j < rtosSEMA_PROF_TOP; ++j) {
+			if (sSP.sTop[j].Count > sSP.sTop[iTop].Count)
+				iTop = j;
+		}
+		u32_t Held = sSP.Takes - (sSP.thHolder ? 1 : 0);	// completed take/give pairs
+		iRV += xReport(psR, "%p %6lu %6lu %6lu %6llu %6llu %6llu %6llu ", sSP.pSH, sSP.Takes, sSP.Contended, sSP.Timeouts,
+						sSP.Contended ? sSP.tWaitSum / sSP.Contended : 0ULL, sSP.tWaitMax,
+						Held ? sSP.tHoldSum / Held : 0ULL, sSP.tHoldMax);
+		iRV += xReport(psR, configFREERTOS_TASKLIST_FMT_DETAIL " ", pcRtosStatsNameWithHandle(psSnap, sSP.thLast));
+		iRV += xReport(psR, configFREERTOS_TASKLIST_FMT_DETAIL "(%lu)" strNL, pcRtosStatsNameWithHandle(psSnap, sSP.sTop[iTop].thTask), sSP.sTop[iTop].Count);
+		if (psR->sFM.bXtras) {
+			iRV += xRtosHistReport(psR, "Wait", &sSP.sWait);
+			iRV += xRtosHistReport(psR, "Hold", &sSP.sHold);
+			if (sSP.Wakes) {
+				iRV += xReport(psR, "    ISR wake %lu avg=%llu max=%llu" strNL, sSP.Wakes, sSP.tWakeSum / sSP.Wakes, sSP.tWakeMax);
+				iRV += xRtosHistReport(psR, "Wake", &sSP.sWake);
+			}
+		}
+	}
+	if (psSnap)
+		vRtosStatsRelease(psSnap);
+	if (SemaProfOverflow)
+		iRV += xReport(psR, "%lu mutexes not profiled, increase rtosSEMA_PROF_MAX" strNL, SemaProfOverflow);
+	if (fmTST(aNL))
+		iRV += xReport(psR, strNL);
+	return iRV;
+}
+#endif
+
+// ################################### Sampling profiler ###########################################
+
+#if (rtosPROF_SLOTS > 0)
+/* Each core samples into its own table from its own tick interrupt, no locking required. Entries are
+ * keyed on PC & task number, open addressing with at most rtosPROF_PROBE probes so the cost of a sample
+ * is bounded, samples that do not find a slot are counted as dropped. */
+typedef struct prof_t {
+	u32_t PC;
+	u32_t Count;
+	u16_t Num;											// task number
+} prof_t;
+
+static prof_t sProf[portNUM_PROCESSORS][rtosPROF_SLOTS] = { 0 };
+static u32_t ProfSamples[portNUM_PROCESSORS] = { 0 };
+static u32_t ProfDropped[portNUM_PROCESSORS] = { 0 };
+static u16_t ProfTick[portNUM_PROCESSORS] = { 0 };
+static u16_t ProfDiv = 1;
+static u8_t ProfOn = 0, ProfHooked = 0;
+
+void IRAM_ATTR vRtosProfSample(void) {
+	if (ProfOn == 0)
+		return;
+	int c = esp_cpu_get_core_id();
+	if (++ProfTick[c] < ProfDiv)
+		return;
+	ProfTick[c] = 0;
+	TaskHandle_t thCur = xTaskGetCurrentTaskHandle();
+	if (thCur == NULL)
+		return;
+	u32_t PC = rtosSAMPLE_PC(thCur);
+	u16_t Num = uxTaskGetTaskNumber(thCur);
+	u32_t Idx = ((PC >> 2) ^ ((u32_t) Num * 0x9E3779B1UL)) & (rtosPROF_SLOTS - 1);
+	++ProfSamples[c];
+	for (int p = 0; p < rtosPROF_PROBE; ++p) {
+		prof_t * psP = &sProf[c][(Idx + p) & (rtosPROF_SLOTS - 1)];
+		if (psP->Count == 0) {
+			psP->PC = PC;
+			psP->Num = Num;
+		} else if (psP->PC != PC || psP->Num != Num) {
+			continue;
+		}
+		++psP->Count;
+		return;
+	}
+	++ProfDropped[c];
+}
+
+int xRtosProfStart(u16_t Div) {
+	ProfDiv = (Div > 0) ? Div : 1;
+	if (ProfHooked == 0) {
+		for (int c = 0; c < portNUM_PROCESSORS; ++c) {
+			if (esp_register_freertos_tick_hook_for_cpu(vRtosProfSample, c) != ESP_OK)
+				return erFAILURE;
+		}
+		ProfHooked = 1;
+	}
+	ProfOn = 1;
+	return erSUCCESS;
+}
+
+void vRtosProfStop(void) { ProfOn = 0; }
+
+void vRtosProfReset(void) {
+	u8_t WasOn = ProfOn;
+	ProfOn = 0;
+	vTaskDelay(1);										// let in-flight samples complete
+	memset(sProf, 0, sizeof(sProf));
+	memset(ProfSamples, 0, sizeof(ProfSamples));
+	memset(ProfDropped, 0, sizeof(ProfDropped));
+	ProfOn = WasOn;
+}
+
+static int xRtosProfCompare(const void * pv1, const void * pv2) {
+	const prof_t * psP1 = pv1, * psP2 = pv2;
+	if (psP1->Num != psP2->Num)
+		return (psP1->Num < psP2->Num) ? -1 : 1;		// by task
+	if (psP1->PC != psP2->PC)
+		return (psP1->PC < psP2->PC) ? -1 : 1;			// then PC, to merge cores
+	return 0;
+}
+
+static int xRtosProfCompareCount(const void * pv1, const void * pv2) {
+	const prof_t * psP1 = pv1, * psP2 = pv2;
+	if (psP1->Num != psP2->Num)
+		return (psP1->Num < psP2->Num) ? -1 : 1;
+	return (psP2->Count > psP1->Count) ? 1 : (psP2->Count < psP1->Count) ? -1 : 0;	// highest count first
+}
+
+int xRtosReportProfile(report_t * psR, int TopN) {
+	u32_t Size = portNUM_PROCESSORS * rtosPROF_SLOTS;
+	prof_t * psAll = pvPortMalloc(Size * sizeof(prof_t));
+	if (psAll == NULL)
+		return xReport(psR, "Profile: no memory" strNL);
+	u8_t WasOn = ProfOn;
+	ProfOn = 0;											// consistent copy, brief gap in sampling
+	memcpy(psAll, sProf, Size * sizeof(prof_t));
+	u32_t Samples = 0, Dropped = 0;
+	for (int c = 0; c < portNUM_PROCESSORS; ++c) {
+		Samples += ProfSamples[c];
+		Dropped += ProfDropped[c];
+	}
+	ProfOn = WasOn;
+	// merge same task & PC sampled on different cores, drop empty slots
+	qsort(psAll, Size, sizeof(prof_t), xRtosProfCompare);
+	u32_t Used = 0;
+	for (u32_t i = 0; i < Size; ++i) {
+		if (psAll[i].Count == 0)
+			continue;
+		if (Used && psAll[Used-1].Num == psAll[i].Num && psAll[Used-1].PC == psAll[i].PC) {
+			psAll[Used-1].Count += psAll[i].Count;
+		} else {
+			psAll[Used++] = psAll[i];
+		}
+	}
+	qsort(psAll, Used, sizeof(prof_t), xRtosProfCompareCount);
+
+	// copy a name per task sampled while the snapshot is owned, released before any output
+	u32_t Tasks = 0;
+	for (u32_t i = 0; i < Used; ++i) {
+		if (i == 0 || psAll[i].Num != psAll[i-1].Num)
+			++Tasks;
+	}
+	char (* pcNames)[CONFIG_FREERTOS_MAX_TASK_NAME_LEN+1] = pvPortMalloc((Tasks ? Tasks : 1) * sizeof(*pcNames));
+	if (pcNames == NULL) {
+		vPortFree(psAll);
+		return xReport(psR, "Profile: no memory" strNL);
+	}
+	rtos_snap_t * psSnap = psRtosStatsSnapshot();		// map task numbers to names, "?" if no memory
+	for (u32_t i = 0, n = 0; i < Used; ++i) {
+		if (i && psAll[i].Num == psAll[i-1].Num)
+			continue;
+		strcpy(pcNames[n], "?");						// deleted since sampled
+		for (int t = 0; psSnap && t < psSnap->Num; ++t) {
+			if (psSnap->sTS[t].xTaskNumber == psAll[i].Num) {
+				strncpy(pcNames[n], psSnap->sTS[t].pcTaskName, CONFIG_FREERTOS_MAX_TASK_NAME_LEN);
+				pcNames[n][CONFIG_FREERTOS_MAX_TASK_NAME_LEN] = 0;
+				break;
+			}
+		}
+		++n;
+	}
+	if (psSnap)
+		vRtosStatsRelease(psSnap);
+
+	int iRV = xReport(psR, "%CProfile%C Samples=%lu  Dropped=%lu  Div=%u  Run=%c" strNL, xpfCOL(colourFG_CYAN,0),
+		xpfCOL(attrRESET,0), Samples, Dropped, ProfDiv, ProfOn ? CHR_Y : CHR_N);
+	for (u32_t i = 0, n = 0; i < Used; ++n) {
+		u16_t Num = psAll[i].Num;
+		u32_t j, Sum = 0;
+		for (j = i; j < Used && psAll[j].Num == Num; ++j)
+			Sum += psAll[j].Count;
+		u32_t TaskMask = (Num && Num <= 32) ? (1UL << (Num - 1)) : 0xFFFFFFFF;
+		if (psR->sFM.uCount & TaskMask) {
+			iRV += xReport(psR, "%C%2u " configFREERTOS_TASKLIST_FMT_DETAIL "%C %lu (%lu%%)" strNL, xpfCOL(colourFG_CYAN,0),
+				Num, pcNames[n], xpfCOL(attrRESET,0), Sum, Samples ? (Sum * 100) / Samples : 0);
+			for (u32_t k = i; k < j && (k - i) < TopN; ++k)	// PCs ready for addr2line -e <app>.elf
+				iRV += xReport(psR, "\t0x%08lX %6lu %3lu%%" strNL, psAll[k].PC, psAll[k].Count, (psAll[k].Count * 100) / Sum);
+		}
+		i = j;
+	}
+	vPortFree(pcNames);
+	vPortFree(psAll);
+	return iRV + xReport(psR, fmTST(aNL) ? strNL : "");
+}
+#endif
+
+#if (rtosWAKE > 0)
+int xRtosReportWake(report_t * psR) {
+	rtos_snap_t * psSnap = psRtosStatsSnapshot();		// map handles to names, handles if no memory
+	int iRV = xReport(psR, "%C%-16s  Same   Savg   Smax  Cross   Xavg   Xmax%C" strNL, xpfCOL(colourFG_CYAN,0), "Primitive", xpfCOL(attrRESET,0));
+	wake_stat_t sS[2];
+	char caName[20];
+	for (int i = 0; i < rtosWAKE_PRIMS; ++i) {
+		taskENTER_CRITICAL(&muxWake);
+		const void * pvKey = sWakePrim[i].pvKey;
+		memcpy(sS, sWakePrim[i].sS, sizeof(sS));		// work on a copy, values are live
+		taskEXIT_CRITICAL(&muxWake);
+		if (pvKey == NULL)
+			continue;									// free or released
+		snprintf(caName, sizeof(caName), "%p", pvKey);
+		iRV += xRtosReportWakeStat(psR, caName, sS);
+	}
+	iRV += xReport(psR, "%C%-16s  Same   Savg   Smax  Cross   Xavg   Xmax%C" strNL, xpfCOL(colourFG_CYAN,0), "Task", xpfCOL(attrRESET,0));
+	for (int i = 0; i < rtosWAKE_TASKS; ++i) {
+		taskENTER_CRITICAL(&muxWake);
+		TaskHandle_t thTask = sWakeTask[i].thTask;
+		memcpy(sS, sWakeTask[i].sS, sizeof(sS));
+		taskEXIT_CRITICAL(&muxWake);
+		if (thTask == NULL)
+			continue;
+		TaskStatus_t * psTS = psRtosStatsFindWithHandle(psSnap, thTask);
+		if (psTS)
+			strncpy(caName, psTS->pcTaskName, sizeof(caName) - 1);
+		else
+			snprintf(caName, sizeof(caName), "%p", thTask);	// deleted
+		caName[sizeof(caName) - 1] = 0;
+		iRV += xRtosReportWakeStat(psR, caName, sS);
+	}
+	if (psSnap)
+		vRtosStatsRelease(psSnap);
+	if (WakeOverflow)
+		iRV += xReport(psR, "%lu waits not tracked, increase rtosWAKE_xxx" strNL, WakeOverflow);
+	return iRV + xReport(psR, fmTST(aNL) ? strNL : "");
+}
+#endif
+
+// ################################### RTOS memory reporting #######################################
+
+static u32_t g_HeapBegin;
+
+void vRtosHeapSetup(void) { g_HeapBegin = xPortGetFreeHeapSize(); }
+
+static const struct { u32_t Caps; const char * pcName; } sHeapRegion[] = {
+	{ MALLOC_CAP_INTERNAL, "INT" },
+#if defined(CONFIG_SPIRAM)
+	{ MALLOC_CAP_SPIRAM, "PSRAM" },
+#endif
+	{ MALLOC_CAP_DMA, "DMA" },
+};
+
+#if defined(CONFIG_HEAP_TASK_TRACKING)
+/* Per task heap accounting, live bytes & blocks from the heap's own (per block) owner tracking. Sampled
+ * by bRtosStatsUpdateHook() and each memory report. Caps slot 0 = internal, 1 = PSRAM. Entries of deleted
+ * tasks are kept while they still own memory. With CONFIG_HEAP_USE_HOOKS the heap hooks keep a running
+ * total per task between samples so the peak is updated on every allocation, not only when sampled. The
+ * hooks can not see the owner of a block being freed, it is charged to the freeing task until the next
+ * sample resynchronises the total with the heap. */
+typedef struct heap_task_t {
+	TaskHandle_t xHandle;								// NULL = free entry
+	u32_t Live[2];										// internal & PSRAM bytes
+	u32_t Blocks;										// live blocks
+	u32_t Peak;											// maximum live bytes (all caps)
+	i32_t Running;										// live bytes, sampled then updated by the hooks
+	u32_t Allocs;										// allocations made, counted by the hooks
+	u8_t bSeen;											// found in latest sample
+} heap_task_t;
+
+static heap_task_t sHeapTask[rtosHEAP_TASKS] = { 0 };
+static heap_task_totals_t sHeapTotals[rtosHEAP_TASKS];
+static portMUX_TYPE muxHeap = portMUX_INITIALIZER_UNLOCKED;
+static u32_t HeapOverflow = 0;
+
+void vRtosHeapSample(void) {
+	static SemaphoreHandle_t shHeapInfo = NULL;			// serialises use of sHeapTotals
+	size_t NumTotals = 0;
+	heap_task_info_params_t sParams = { 0 };
+	sParams.mask[0] = sParams.caps[0] = MALLOC_CAP_INTERNAL;
+	sParams.mask[1] = sParams.caps[1] = MALLOC_CAP_SPIRAM;
+	for (int i = 2; i < NUM_HEAP_TASK_CAPS; ++i)
+		sParams.caps[i] = 1;							// mask 0 never matches caps 1, slot unused
+	sParams.totals = sHeapTotals;
+	sParams.num_totals = &NumTotals;
+	sParams.max_totals = rtosHEAP_TASKS;
+	BaseType_t btRV = xRtosSemaphoreTake(&shHeapInfo, portMAX_DELAY);
+	memset(sHeapTotals, 0, sizeof(sHeapTotals));
+	heap_caps_get_per_task_info(&sParams);
+	taskENTER_CRITICAL(&muxHeap);
+	for (int i = 0; i < rtosHEAP_TASKS; ++i)
+		sHeapTask[i].bSeen = 0;
+	for (int t = 0; t < NumTotals; ++t) {
+		heap_task_totals_t * psHT = &sHeapTotals[t];
+		heap_task_t * psFree = NULL, * psH = NULL;
+		for (int i = 0; i < rtosHEAP_TASKS; ++i) {
+			if (sHeapTask[i].xHandle == psHT->task) {
+				psH = &sHeapTask[i];
+				break;
+			}
+			if (psFree == NULL && sHeapTask[i].xHandle == NULL)
+				psFree = &sHeapTask[i];
+		}
+		if (psH == NULL && psFree) {
+			psH = psFree;
+			memset(psH, 0, sizeof(heap_task_t));
+			psH->xHandle = psHT->task;
+		}
+		if (psH == NULL) {
+			++HeapOverflow;
+			continue;
+		}
+		psH->Live[0] = psHT->size[0];
+		psH->Live[1] = psHT->size[1];
+		psH->Blocks = psHT->count[0] + psHT->count[1];
+		psH->Running = psH->Live[0] + psH->Live[1];
+		if (psH->Running > psH->Peak)
+			psH->Peak = psH->Running;
+		psH->bSeen = 1;
+	}
+	for (int i = 0; i < rtosHEAP_TASKS; ++i) {			// nothing allocated anymore, release
+		if (sHeapTask[i].bSeen == 0)
+			sHeapTask[i].xHandle = NULL;
+	}
+	taskEXIT_CRITICAL(&muxHeap);
+	if (btRV == pdTRUE)
+		xRtosSemaphoreGive(&shHeapInfo);
+}
+
+#if defined(CONFIG_HEAP_USE_HOOKS)
+/**
+ * @brief		update the running live bytes (and peak) of the current task from the heap hooks
+ * @param[in]	pvMem block being allocated or freed
+ * @param[in]	bAlloc 1 if allocated, 0 if being freed
+ * @note		tasks are only tracked once present in a sample, not from ISRs
+ */
+static void IRAM_ATTR vRtosHeapHook(void * pvMem, bool bAlloc) {
+	if (pvMem == NULL || halNVIC_CalledFromISR() || xTaskGetSchedulerState() == taskSCHEDULER_NOT_STARTED)
+		return;
+	TaskHandle_t thMe = xTaskGetCurrentTaskHandle();
+	i32_t Size = heap_caps_get_allocated_size(pvMem);
+	portENTER_CRITICAL_SAFE(&muxHeap);
+	for (int i = 0; i < rtosHEAP_TASKS; ++i) {
+		heap_task_t * psH = &sHeapTask[i];
+		if (psH->xHandle != thMe)
+			continue;
+		if (bAlloc) {
+			psH->Running += Size;
+			++psH->Allocs;
+			if (psH->Running > (i32_t) psH->Peak)
+				psH->Peak = psH->Running;
+		} else {
+			psH->Running -= Size;
+		}
+		break;
+	}
+	portEXIT_CRITICAL_SAFE(&muxHeap);
+}
+#endif
+#endif
+
+int xRtosReportMemory(report_t * psR) {
+	int iRV = xReport(psR, "%CFreeRTOS:%C %#'u -> %#'u <- %#'u", xpfCOL(colourFG_CYAN,0), xpfCOL(attrRESET,0),
+		xPortGetMinimumEverFreeHeapSize(), xPortGetFreeHeapSize(), g_HeapBegin);
+#if (rtosSEMA_POOL_SIZE > 0)
+	iRV += xReport(psR, "  Mutex pool %lu/%d HWM=%lu heap=%lu", SemaPoolUsed, rtosSEMA_POOL_SIZE, SemaPoolHWM, SemaPoolHeap);
+#endif
+	iRV += xReport(psR, strNL);
+	// Fragmentation indicators per capability region
+	iRV += xReport(psR, "%CRegion     Free  Largest Blocks  MinFree Frag%%%C" strNL, xpfCOL(colourFG_CYAN,0), xpfCOL(attrRESET,0));
+	for (int r = 0; r < NO_MEM(sHeapRegion); ++r) {
+		multi_heap_info_t sMHI;
+		heap_caps_get_info(&sMHI, sHeapRegion[r].Caps);
+		u32_t Frag = sMHI.total_free_bytes ? 100 - ((sMHI.largest_free_block * 100) / sMHI.total_free_bytes) : 0;
+		iRV += xReport(psR, "%-6s %#'9u %#'8u %6u %#'8u %4lu" strNL, sHeapRegion[r].pcName, sMHI.total_free_bytes,
+			sMHI.largest_free_block, sMHI.free_blocks, sMHI.minimum_free_bytes, Frag);
+	}
+#if defined(CONFIG_HEAP_TASK_TRACKING)
+	// Per task allocation accounting, same task selection & columns as the task report
+	rtos_snap_t * psSnap = psRtosStatsSnapshot();		// map handles to numbers & names, handles if no memory
+	vRtosHeapSample();
+	iRV += xReport(psR, "%C", xpfCOL(colourFG_CYAN,0));
+	if (psR->sFM.bTskNum)			iRV += xReport(psR, "T# ");
+	iRV += xReport(psR, configFREERTOS_TASKLIST_HDR_DETAIL "Live(I)  Live(S)     Peak Blocks");
+	#if defined(CONFIG_HEAP_USE_HOOKS)
+	iRV += xReport(psR, " Allocs");
+	#endif
+	iRV += xReport(psR, "%C" strNL, xpfCOL(attrRESET,0));
+	heap_task_t sH;
+	for (int i = 0; i < rtosHEAP_TASKS; ++i) {
+		taskENTER_CRITICAL(&muxHeap);
+		memcpy(&sH, &sHeapTask[i], sizeof(heap_task_t));
+		taskEXIT_CRITICAL(&muxHeap);
+		if (sH.xHandle == NULL)
+			continue;
+		TaskStatus_t * psTS = psRtosStatsFindWithHandle(psSnap, sH.xHandle);
+		if (psTS) {										// deleted tasks (leaks) always shown
+			u32_t TaskMask = (psTS->xTaskNumber <= 32) ? (1UL << (psTS->xTaskNumber - 1)) : 0xFFFFFFFF;
+			if ((psR->sFM.uCount & TaskMask) == 0)
+				continue;
+		}
+		if (psTS) {
+			if (psR->sFM.bTskNum)	iRV += xReport(psR, "%2u ", psTS->xTaskNumber);
+			iRV += xReport(psR, configFREERTOS_TASKLIST_FMT_DETAIL, psTS->pcTaskName);
+		} else {
+			char caName[12];
+			snprintf(caName, sizeof(caName), "%p", sH.xHandle);
+			if (psR->sFM.bTskNum)	iRV += xReport(psR, "-- ");
+			iRV += xReport(psR, configFREERTOS_TASKLIST_FMT_DETAIL, caName);
+		}
+		iRV += xReport(psR, "%#'7lu %#'8lu %#'8lu %6lu", sH.Live[0], sH.Live[1], sH.Peak, sH.Blocks);
+		#if defined(CONFIG_HEAP_USE_HOOKS)
+		iRV += xReport(psR, " %6lu", sH.Allocs);
+		#endif
+		iRV += xReport(psR, strNL);
+	}
+	if (psSnap)
+		vRtosStatsRelease(psSnap);
+	if (HeapOverflow)
+		iRV += xReport(psR, "%lu samples not tracked, increase rtosHEAP_TASKS" strNL, HeapOverflow);
+#endif
+	return iRV + xReport(psR, fmTST(aNL) ? strNL : "");
+}
+
+// ###################################### Heap leak tracing ########################################
+
+#if defined(CONFIG_HEAP_USE_HOOKS) && (rtosLEAK_RING > 0)
+
+/* Allocation/free events of tasks with an open MALLOC_MARK() scope are recorded in a ring. The heap hooks
+ * return after a single load when no scope is open anywhere, otherwise after comparing the current task
+ * with the (few) open scopes. MALLOC_CHECK() pairs allocations with frees made after the mark by the same
+ * task and reports the remainder. Events are not recorded from ISRs. */
+typedef struct leak_evt_t {
+	void * pvMem;
+	u32_t Caller;										// PC of malloc() caller
+	u32_t Size;											// 0 = free
+	u32_t tStamp;										// runtime counter, low 32 bits
+	TaskHandle_t thTask;
+} leak_evt_t;
+
+static leak_evt_t sLeakRing[rtosLEAK_RING];
+static struct { TaskHandle_t thTask; u32_t Seq; size_t Free; } sLeakScope[rtosLEAK_SCOPES] = { 0 };
+static u32_t LeakSeq = 0;								// total events recorded
+static u32_t LeakScopes = 0;							// currently open scopes
+static portMUX_TYPE muxLeak = portMUX_INITIALIZER_UNLOCKED;
+
+static void IRAM_ATTR vRtosLeakRecord(void * pvMem, size_t Size, u32_t Caller) {
+	if (__atomic_load_n(&LeakScopes, __ATOMIC_RELAXED) == 0 || halNVIC_CalledFromISR() || pvMem == NULL)
+		return;
+	TaskHandle_t thMe = xTaskGetCurrentTaskHandle();
+	int i;
+	for (i = 0; i < rtosLEAK_SCOPES && sLeakScope[i].thTask != thMe; ++i);
+	if (i == rtosLEAK_SCOPES)
+		return;											// not a task with an open scope
+	portENTER_CRITICAL_SAFE(&muxLeak);
+	leak_evt_t * psE = &sLeakRing[LeakSeq++ % rtosLEAK_RING];
+	psE->pvMem = pvMem;
+	psE->Caller = Caller;
+	psE->Size = Size;
+	psE->tStamp = (u32_t) rtosRT_NOW();
+	psE->thTask = thMe;
+	portEXIT_CRITICAL_SAFE(&muxLeak);
+}
+
+
+int xRtosLeakMark(void) {
+	TaskHandle_t thMe = xTaskGetCurrentTaskHandle();
+	int iRV = erFAILURE;
+	portENTER_CRITICAL_SAFE(&muxLeak);
+	for (int i = 0; i < rtosLEAK_SCOPES; ++i) {
+		if (sLeakScope[i].thTask == NULL) {
+			sLeakScope[i].thTask = thMe;
+			sLeakScope[i].Seq = LeakSeq;
+			sLeakScope[i].Free = xPortGetFreeHeapSize();
+			++LeakScopes;
+			iRV = i;
+			break;
+		}
+	}
+	portEXIT_CRITICAL_SAFE(&muxLeak);
+	return iRV;
+}
+
+int xRtosLeakCheck(int iScope) {
+	if (INRANGE(0, iScope, rtosLEAK_SCOPES-1) == 0)
+		return erINV_PARA;
+	// Close the scope first so our own output does not get recorded, unless nested in same task
+	portENTER_CRITICAL_SAFE(&muxLeak);
+	TaskHandle_t thMe = sLeakScope[iScope].thTask;
+	if (thMe == NULL) {									// never opened, or already checked
+		portEXIT_CRITICAL_SAFE(&muxLeak);
+		return erINV_PARA;
+	}
+	u32_t Seq = sLeakScope[iScope].Seq;
+	size_t Free = sLeakScope[iScope].Free;
+	sLeakScope[iScope].thTask = NULL;
+	--LeakScopes;										// only for a scope that was open
+	u32_t Last = LeakSeq;
+	portEXIT_CRITICAL_SAFE(&muxLeak);
+	u32_t Lost = 0;
+	if ((Last - Seq) > rtosLEAK_RING) {					// oldest events overwritten, check what remains
+		Lost = Last - Seq - rtosLEAK_RING;
+		Seq = Last - rtosLEAK_RING;
+	}
+	int Leaks = 0;
+	for (u32_t s = Seq; s != Last; ++s) {
+		leak_evt_t sE = sLeakRing[s % rtosLEAK_RING];
+		if (sE.thTask != thMe || sE.Size == 0)
+			continue;
+		u32_t f;										// look for a later free of the same block
+		for (f = s + 1; f != Last; ++f) {
+			leak_evt_t * psF = &sLeakRing[f % rtosLEAK_RING];
+			if (psF->pvMem == sE.pvMem && psF->thTask == thMe && psF->Size == 0)
+				break;
+		}
+		if (f != Last)
+			continue;
+		SP("LEAK %p size=%lu pc=0x%08lX t=%lu" strNL, sE.pvMem, sE.Size, sE.Caller, sE.tStamp);
+		++Leaks;
+	}
+	if (Leaks || Lost)
+		SP("LEAK %d blocks, %lu events lost, heap %u -> %u" strNL, Leaks, Lost, Free, xPortGetFreeHeapSize());
+	return Leaks;
+}
+#endif
+
+#if defined(CONFIG_HEAP_USE_HOOKS) && ((rtosLEAK_RING > 0) || defined(CONFIG_HEAP_TASK_TRACKING))
+void IRAM_ATTR esp_heap_trace_alloc_hook(void * pvMem, size_t Size, u32_t Caps) {
+	#if (rtosLEAK_RING > 0)
+	#if defined(CONFIG_IDF_TARGET_ARCH_XTENSA)			// hook <- heap_caps_* <- malloc <- caller
+		vRtosLeakRecord(pvMem, Size ? Size : 1, rtosCALLER_PC(__builtin_return_address(rtosLEAK_CALLER)));
+	#else
+		vRtosLeakRecord(pvMem, Size ? Size : 1, 0);
+	#endif
+	#endif
+	#if defined(CONFIG_HEAP_TASK_TRACKING)
+		vRtosHeapHook(pvMem, 1);
+	#endif
+}
+
+void IRAM_ATTR esp_heap_trace_free_hook(void * pvMem) {
+	#if (rtosLEAK_RING > 0)
+		vRtosLeakRecord(pvMem, 0, 0);
+	#endif
+	#if defined(CONFIG_HEAP_TASK_TRACKING)
+		vRtosHeapHook(pvMem, 0);
+	#endif
+}
+#endif
+
+// ############################## Timer service instrumentation ####################################
+
+#if (cmakeWRAP_TIMERS == 1)
+
+/* Timers created via the wrappers get a record, found by handle so the timer number remains available
+ * to the application, and the user callback is replaced by a trampoline that measures each invocation. Expected
+ * expiry: the daemon has already reloaded an auto-reload timer before calling back, so the expiry
+ * time is one period ahead, for a one-shot timer the expiry time is the one that just expired.
+ * Only xRtosTimerDelete() releases a record, after a plain xTimerDelete() it keeps the dead handle until
+ * a new timer gets the same address. Hence the name is copied at creation, the report never touches
+ * the handle. */
+typedef struct rtos_tmr_t {
+	TimerHandle_t thTimer;								// NULL = free record
+	TimerCallbackFunction_t pfCB;						// user callback
+	char caName[16];									// copy, handle may be stale
+	u32_t Calls;
+	u32_t Late;											// callbacks run 1 or more ticks late
+	u32_t LateSum, LateMax;								// ticks
+	u32_t Missed;										// periods missed (auto-reload)
+	u32_t Overrun;										// callbacks executing longer than the period
+	u64_t tExecSum, tExecMax;							// runtime counter units
+	rtos_hist_t sExec;
+} rtos_tmr_t;
+
+static rtos_tmr_t sTmr[rtosTIMER_MAX] = { 0 };
+static portMUX_TYPE muxTmr = portMUX_INITIALIZER_UNLOCKED;
+static u32_t TmrOverflow = 0;
+static struct { u64_t tSent, tSum, tMax; u32_t Sent, Done, Fail; rtos_hist_t sLat; } sTmrProbe = { 0 };
+
+static rtos_tmr_t * psRtosTimerGet(TimerHandle_t thTimer) {
+	if (thTimer == NULL)
+		return NULL;
+	for (int i = 0; i < rtosTIMER_MAX; ++i) {
+		if (sTmr[i].thTimer == thTimer)
+			return &sTmr[i];
+	}
+	return NULL;
+}
+
+/**
+ * @brief		measure lateness & execution time around the user callback
+ * @param[in]	thTimer handle of the expired timer
+ * @note		executes in the timer daemon task, which serialises all updates to the record
+ */
+static void vRtosTimerTrampoline(TimerHandle_t thTimer) {
+	rtos_tmr_t * psT = psRtosTimerGet(thTimer);
+	if (psT == NULL)
+		return;											// record released, timer being deleted
+	TickType_t tNow = xTaskGetTickCount();
+	TickType_t tPer = xTimerGetPeriod(thTimer);
+	TickType_t tExp = xTimerGetExpiryTime(thTimer);
+	if (uxTimerGetReloadMode(thTimer))
+		tExp -= tPer;
+	u32_t tLate = (i32_t) (tNow - tExp) > 0 ? tNow - tExp : 0;
+	u64_t tStart = rtosRT_NOW();
+	psT->pfCB(thTimer);
+	u64_t tExec = rtosRT_NOW() - tStart;
+	++psT->Calls;
+	if (tLate) {
+		++psT->Late;
+		psT->LateSum += tLate;
+		if (tLate > psT->LateMax)
+			psT->LateMax = tLate;
+		if (uxTimerGetReloadMode(thTimer) && tPer && tLate >= tPer)
+			psT->Missed += tLate / tPer;
+	}
+	psT->tExecSum += tExec;
+	if (tExec > psT->tExecMax)
+		psT->tExecMax = tExec;
+	vRtosHistAdd(&psT->sExec, tExec);
+	if (tExec > ((u64_t) tPer * portTICK_PERIOD_MS * 1000ULL))	// runtime counter in uSec
+		++psT->Overrun;
+}
+
+/**
+ * @brief		reserve a record for a timer about to be created
+ * @param[in]	pcName timer name, NULL allowed
+ * @param[in]	pfCB user callback
+ * @return		pointer to record or NULL if table full (timer created uninstrumented)
+ */
+static rtos_tmr_t * psRtosTimerAlloc(const char * pcName, TimerCallbackFunction_t pfCB) {
+	rtos_tmr_t * psT = NULL;
+	taskENTER_CRITICAL(&muxTmr);
+	for (int i = 0; i < rtosTIMER_MAX; ++i) {
+		if (sTmr[i].thTimer == NULL && sTmr[i].pfCB == NULL) {
+			psT = &sTmr[i];
+			memset(psT, 0, sizeof(rtos_tmr_t));
+			psT->pfCB = pfCB;							// reserved until handle known
+			if (pcName)
+				strncpy(psT->caName, pcName, sizeof(psT->caName) - 1);
+			break;
+		}
+	}
+	if (psT == NULL)
+		++TmrOverflow;
+	taskEXIT_CRITICAL(&muxTmr);
+	return psT;
+}
+
+/**
+ * @brief		complete a reserved record once the timer has been created
+ * @param[in]	psT pointer to record, NULL if none reserved
+ * @param[in]	thTimer handle of new timer, NULL if creation failed
+ * @return		thTimer
+ * @note		any other record holding the same handle belongs to a timer deleted with plain
+ * 				xTimerDelete() whose memory has been reused, it is released
+ */
+static TimerHandle_t xRtosTimerAttach(rtos_tmr_t * psT, TimerHandle_t thTimer) {
+	if (psT == NULL)
+		return thTimer;
+	taskENTER_CRITICAL(&muxTmr);
+	if (thTimer) {
+		for (int i = 0; i < rtosTIMER_MAX; ++i) {
+			if (sTmr[i].thTimer == thTimer) {
+				sTmr[i].thTimer = NULL;
+				sTmr[i].pfCB = NULL;
+			}
+		}
+		psT->thTimer = thTimer;
+	} else {
+		psT->pfCB = NULL;								// creation failed, release
+	}
+	taskEXIT_CRITICAL(&muxTmr);
+	return thTimer;
+}
+
+TimerHandle_t __wrap_xTimerCreate(const char * const pcName, const TickType_t tPer, const UBaseType_t uxAuto, void * const pvID, TimerCallbackFunction_t pfCB) {
+	rtos_tmr_t * psT = psRtosTimerAlloc(pcName, pfCB);
+	return xRtosTimerAttach(psT, __real_xTimerCreate(pcName, tPer, uxAuto, pvID, psT ? vRtosTimerTrampoline : pfCB));
+}
+
+TimerHandle_t __wrap_xTimerCreateStatic(const char * const pcName, const TickType_t tPer, const UBaseType_t uxAuto, void * const pvID, TimerCallbackFunction_t pfCB, StaticTimer_t * psTB) {
+	rtos_tmr_t * psT = psRtosTimerAlloc(pcName, pfCB);
+	return xRtosTimerAttach(psT, __real_xTimerCreateStatic(pcName, tPer, uxAuto, pvID, psT ? vRtosTimerTrampoline : pfCB, psTB));
+}
+
+BaseType_t xRtosTimerDelete(TimerHandle_t thTimer, TickType_t tW) {
+	BaseType_t btRV = xTimerDelete(thTimer, tW);
+	if (btRV == pdPASS) {								// trampoline ignores calls from here on
+		taskENTER_CRITICAL(&muxTmr);
+		rtos_tmr_t * psT = psRtosTimerGet(thTimer);
+		if (psT) {
+			psT->thTimer = NULL;
+			psT->pfCB = NULL;
+		}
+		taskEXIT_CRITICAL(&muxTmr);
+	}
+	return btRV;
+}
+
+static void vRtosTimerProbeCB(void * pvPara, u32_t u32Para) {
+	u64_t tLat = rtosRT_NOW() - sTmrProbe.tSent;
+	++sTmrProbe.Done;
+	sTmrProbe.tSum += tLat;
+	if (tLat > sTmrProbe.tMax)
+		sTmrProbe.tMax = tLat;
+	vRtosHistAdd(&sTmrProbe.sLat, tLat);
+}
+
+void vRtosTimerProbe(void) {
+	if (sTmrProbe.Sent != sTmrProbe.Done + sTmrProbe.Fail)
+		return;											// previous probe still queued
+	sTmrProbe.tSent = rtosRT_NOW();
+	++sTmrProbe.Sent;
+	if (xTimerPendFunctionCall(vRtosTimerProbeCB, NULL, 0, 0) != pdPASS)
+		++sTmrProbe.Fail;								// queue full
+}
+
+int xRtosReportTimers(report_t * psR) {
+	int iRV = xReport(psR, "%C%-16s Calls  Late Lavg Lmax Miss Ovr   Eavg   Emax%C" strNL,
+					xpfCOL(colourFG_CYAN,0), "Timer", xpfCOL(attrRESET,0));
+	rtos_tmr_t sT;
+	for (int i = 0; i < rtosTIMER_MAX; ++i) {
+		taskENTER_CRITICAL(&muxTmr);
+		memcpy(&sT, &sTmr[i], sizeof(rtos_tmr_t));		// work on a copy, values are live
+		taskEXIT_CRITICAL(&muxTmr);
+		if (sT.thTimer == NULL)
+			continue;
+		iRV += xReport(psR, "%-16.16s %5lu %5lu %4lu %4lu %4lu %3lu %6llu %6llu" strNL, sT.caName, sT.Calls,
+			sT.Late, sT.Late ? sT.LateSum / sT.Late : 0, sT.LateMax, sT.Missed, sT.Overrun,
+			sT.Calls ? sT.tExecSum / sT.Calls : 0ULL, sT.tExecMax);
+		if (psR->sFM.bXtras)
+			iRV += xRtosHistReport(psR, "Exec", &sT.sExec);
+	}
+	iRV += xReport(psR, "Daemon queue: probes %lu/%lu full=%lu  Lavg=%llu  Lmax=%llu" strNL, sTmrProbe.Done, sTmrProbe.Sent,
+		sTmrProbe.Fail, sTmrProbe.Done ? sTmrProbe.tSum / sTmrProbe.Done : 0ULL, sTmrProbe.tMax);
+	if (psR->sFM.bXtras)
+		iRV += xRtosHistReport(psR, "Queue", &sTmrProbe.sLat);
+	if (TmrOverflow)
+		iRV += xReport(psR, "%lu timers not instrumented, increase rtosTIMER_MAX" strNL, TmrOverflow);
+	if (fmTST(aNL))
+		iRV += xReport(psR, strNL);
+	return iRV;
+}
+#endif
+
+// #################################### RTOS timer reporting #######################################
+
+/**
+ * @brief	report config & status of timer specified
+ * @param	psR pointer to report control structure
+ * @param	thTmr timer handle to be reported on
+ * @return	size of character output generated
+ * @note	DOES specifically lock/unlock console UART
+*/
+int xRtosReportTimer(report_t * psR, TimerHandle_t thTmr) {
+	int iRV;
+	if (halMemorySRAM(thTmr)) {
+		TickType_t tPer = xTimerGetPeriod(thTmr);
+		TickType_t tExp = xTimerGetExpiryTime(thTmr);
+		i32_t tRem = tExp - xTaskGetTickCount();
+		BaseType_t bActive = xTimerIsTimerActive(thTmr); 
+		iRV = xReport(psR, "%C%s%C\t#%lu  Auto=%c  Run=%c", xpfCOL(colourFG_CYAN,0), pcTimerGetName(thTmr), xpfCOL(attrRESET,0),
+			uxTimerGetTimerNumber(thTmr), uxTimerGetReloadMode(thTmr) ? CHR_Y : CHR_N, bActive ? CHR_Y : CHR_N);
+		if (bActive)
+			iRV += xReport(psR, "  tPeriod=%#'lu  tExpiry=%#'lu  tRemain=%#'ld", tPer, tExp, tRem);
+#if (cmakeWRAP_TIMERS == 1)
+		rtos_tmr_t * psT = psRtosTimerGet(thTmr);
+		if (psT)
+			iRV += xReport(psR, "  Calls=%lu  Late=%lu/%lu  Miss=%lu  Ovr=%lu  Emax=%llu", psT->Calls, psT->Late,
+				psT->LateMax, psT->Missed, psT->Overrun, psT->tExecMax);
+#endif
+	} else {
+		iRV = xReport(psR, "\t%p Invalid Timer handle", thTmr);
+	}
+	if (fmTST(aNL))
+		iRV += xReport(psR, strNL);
+	return iRV;
+}
+
+// ##################################### CBOR telemetry ############################################
+
+#define cborUINT					0x00				// major types, shifted into top 3 bits
+#define cborNINT					0x20
+#define cborTEXT					0x60
+#define cborARRAY					0x80
+#define cborSIMPLE					0xE0
+#define cborINDEF					0x1F				// indefinite length, terminated with BREAK
+#define cborFALSE					0xF4
+#define cborTRUE					0xF5
+#define cborBREAK					0xFF
+
+void vRtosCborInit(rtos_cbor_t * psC, rtos_sink_t pfSink, void * pvArg) {
+	memset(psC, 0, sizeof(rtos_cbor_t));
+	psC->pfSink = pfSink;
+	psC->pvArg = pvArg;
+}
+
+/**
+ * @brief		pass staged output to the sink
+ * @param[in]	psC pointer to encoder context
+ */
+static void vRtosCborFlush(rtos_cbor_t * psC) {
+	if (psC->Used && psC->iRV >= 0) {
+		int iRV = psC->pfSink(psC->pvArg, psC->Buf, psC->Used);
+		psC->iRV = (iRV < 0) ? erFAILURE : psC->iRV + iRV;
+	}
+	psC->Used = 0;
+}
+
+static void vRtosCborPut(rtos_cbor_t * psC, const u8_t * pu8, size_t Size) {
+	while (Size) {
+		if (psC->Used == rtosCBOR_BUF_SIZE)
+			vRtosCborFlush(psC);
+		size_t Len = rtosCBOR_BUF_SIZE - psC->Used;
+		if (Len > Size)
+			Len = Size;
+		memcpy(&psC->Buf[psC->Used], pu8, Len);
+		psC->Used += Len;
+		pu8 += Len;
+		Size -= Len;
+	}
+}
+
+/**
+ * @brief		encode an item head, shortest form of the argument
+ * @param[in]	psC pointer to encoder context
+ * @param[in]	Major major type
+ * @param[in]	Val argument (value, length or count)
+ */
+static void vRtosCborHead(rtos_cbor_t * psC, u8_t Major, u64_t Val) {
+	u8_t Buf[9];
+	int Len;
+	if (Val < 24ULL) {
+		Buf[0] = Major | Val;
+		Len = 0;
+	} else if (Val <= 0xFFULL) {
+		Buf[0] = Major | 24;
+		Len = 1;
+	} else if (Val <= 0xFFFFULL) {
+		Buf[0] = Major | 25;
+		Len = 2;
+	} else if (Val <= 0xFFFFFFFFULL) {
+		Buf[0] = Major | 26;
+		Len = 4;
+	} else {
+		Buf[0] = Major | 27;
+		Len = 8;
+	}
+	for (int i = Len; i > 0; --i, Val >>= 8)			// network (big endian) order
+		Buf[i] = Val & 0xFF;
+	vRtosCborPut(psC, Buf, Len + 1);
+}
+
+static void vRtosCborUint(rtos_cbor_t * psC, u64_t Val) { vRtosCborHead(psC, cborUINT, Val); }
+
+static void vRtosCborInt(rtos_cbor_t * psC, i64_t Val) {
+	if (Val < 0)
+		vRtosCborHead(psC, cborNINT, (u64_t) (-1 - Val));
+	else
+		vRtosCborHead(psC, cborUINT, (u64_t) Val);
+}
+
+static void vRtosCborText(rtos_cbor_t * psC, const char * pcStr) {
+	size_t Len = pcStr ? strlen(pcStr) : 0;
+	vRtosCborHead(psC, cborTEXT, Len);
+	vRtosCborPut(psC, (const u8_t *) pcStr, Len);
+}
+
+static void vRtosCborByte(rtos_cbor_t * psC, u8_t Byte) { vRtosCborPut(psC, &Byte, 1); }
+
+static void vRtosCborBool(rtos_cbor_t * psC, bool bVal) { vRtosCborByte(psC, bVal ? cborTRUE : cborFALSE); }
+
+/**
+ * @brief		start a report, array with schema version & report type as first 2 items
+ * @param[in]	psC pointer to encoder context
+ * @param[in]	Type report type
+ * @param[in]	Items number of report specific items to follow
+ */
+static void vRtosCborStart(rtos_cbor_t * psC, int Type, int Items) {
+	vRtosCborHead(psC, cborARRAY, Items + 2);
+	vRtosCborUint(psC, rtosCBOR_SCHEMA);
+	vRtosCborUint(psC, Type);
+}
+
+static int xRtosCborEnd(rtos_cbor_t * psC) {
+	vRtosCborFlush(psC);
+	return psC->iRV;
+}
+
+int xRtosEncodeTasks(rtos_cbor_t * psC) {
+	rtos_snap_t * psSnap = psRtosStatsSnapshot();
+	if (psSnap == NULL)
+		return erFAILURE;
+	vRtosCborStart(psC, rtosCBOR_TASKS, 3);
+	vRtosCborUint(psC, psSnap->Total);
+	vRtosCborUint(psC, portNUM_PROCESSORS);
+	vRtosCborByte(psC, cborARRAY | cborINDEF);			// stream, invalid entries skipped
+	for (int a = 0; a < psSnap->Num; ++a) {
+		TaskStatus_t * psTS = &psSnap->sTS[a];
+		if (psTS->eCurrentState >= eInvalid)
+			continue;
+		vRtosCborHead(psC, cborARRAY, 8);
+		vRtosCborUint(psC, psTS->xTaskNumber);
+		vRtosCborText(psC, psTS->pcTaskName);
+		vRtosCborUint(psC, psTS->uxCurrentPriority);
+		vRtosCborUint(psC, psTS->uxBasePriority);
+		vRtosCborUint(psC, psTS->eCurrentState);
+		vRtosCborUint(psC, psTS->usStackHighWaterMark);
+		vRtosCborUint(psC, INRANGE(0, rtosTS_CORE(psTS), portNUM_PROCESSORS-1) ? rtosTS_CORE(psTS) : portNUM_PROCESSORS);
+		vRtosCborUint(psC, psTS->ulRunTimeCounter);
+	}
+	vRtosStatsRelease(psSnap);
+	vRtosCborByte(psC, cborBREAK);
+	return xRtosCborEnd(psC);
+}
+
+int xRtosEncodeMemory(rtos_cbor_t * psC) {
+	vRtosCborStart(psC, rtosCBOR_MEMORY, 6);
+	vRtosCborUint(psC, xPortGetMinimumEverFreeHeapSize());
+	vRtosCborUint(psC, xPortGetFreeHeapSize());
+	vRtosCborUint(psC, g_HeapBegin);
+#if (rtosSEMA_POOL_SIZE > 0)
+	vRtosCborUint(psC, SemaPoolUsed);
+	vRtosCborUint(psC, SemaPoolHWM);
+	vRtosCborUint(psC, SemaPoolHeap);
+#else
+	vRtosCborUint(psC, 0);
+	vRtosCborUint(psC, 0);
+	vRtosCborUint(psC, 0);
+#endif
+	return xRtosCborEnd(psC);
+}
+
+int xRtosEncodeTimer(rtos_cbor_t * psC, TimerHandle_t thTmr) {
+	if (halMemorySRAM(thTmr) == 0)
+		return erINV_PARA;
+	TickType_t tExp = xTimerGetExpiryTime(thTmr);
+	vRtosCborStart(psC, rtosCBOR_TIMER, 7);
+	vRtosCborUint(psC, uxTimerGetTimerNumber(thTmr));
+	vRtosCborText(psC, pcTimerGetName(thTmr));
+	vRtosCborBool(psC, uxTimerGetReloadMode(thTmr));
+	vRtosCborBool(psC, xTimerIsTimerActive(thTmr));
+	vRtosCborUint(psC, xTimerGetPeriod(thTmr));
+	vRtosCborUint(psC, tExp);
+	vRtosCborInt(psC, (i32_t) (tExp - xTaskGetTickCount()));
+	return xRtosCborEnd(psC);
+}
+
+// ################################### Stack usage tracking ########################################
+
+#if (rtosSTACK_MAX > 0)
+
+#define stackMAGIC					0x5374434BUL		// "StCK"
+
+/* Lifetime stack records, keyed on task name so they survive task deletion and (in no-init RAM) soft
+ * reboots. Validity across reboots is established with a magic number & checksum, all updates are
+ * done under muxStack. The checksum is the XOR of all words, each rotated by its position, so an update
+ * only removes the old and adds the new contribution of the words it changes, the full table is only
+ * walked once per boot. Depth & free stack in the same units as usStackDepth & uxTaskGetStackHighWaterMark() */
+typedef struct stack_rec_t {
+	char caName[CONFIG_FREERTOS_MAX_TASK_NAME_LEN];		// not terminated if max length
+	u32_t Depth;										// requested at (latest) creation, 0 if unknown
+	u32_t MinFree;										// lifetime minimum free
+	u16_t Creates;
+	u8_t bStatic;
+	u8_t Spare;
+} stack_rec_t;
+
+typedef struct stack_log_t {
+	u32_t Magic;
+	u32_t Boots;
+	u32_t Overflow;										// tasks not tracked, table full
+	stack_rec_t sRec[rtosSTACK_MAX];
+	u32_t Check;
+} stack_log_t;
+
+static __NOINIT_ATTR stack_log_t sStackLog;
+static portMUX_TYPE muxStack = portMUX_INITIALIZER_UNLOCKED;
+static bool bStackValid = 0;
+
+/**
+ * @brief		checksum contribution of a range of (word aligned) words within sStackLog
+ * @param[in]	pvStart address of first word
+ * @param[in]	Size in bytes, multiple of 4
+ * @return		contribution, XOR into Check before and again after modifying the range
+ */
+static u32_t xRtosStackCheckWords(const void * pvStart, size_t Size) {
+	const u32_t * pu32 = pvStart;
+	u32_t Idx = pu32 - (const u32_t *) &sStackLog;
+	u32_t Check = 0;
+	for (; Size >= sizeof(u32_t); Size -= sizeof(u32_t), ++pu32, ++Idx)
+		Check ^= (*pu32 << (Idx & 31)) | (*pu32 >> ((32 - Idx) & 31));
+	return Check;
+}
+
+static u32_t xRtosStackCheck(void) { return xRtosStackCheckWords(&sStackLog, offsetof(stack_log_t, Check)); }
+
+/**
+ * @brief		validate (once per boot) the retained records, reset if corrupt or first power on
+ * @note		called with muxStack held
+ */
+static void vRtosStackValidate(void) {
+	if (bStackValid)
+		return;
+	if (sStackLog.Magic != stackMAGIC || sStackLog.Check != xRtosStackCheck()) {
+		memset(&sStackLog, 0, sizeof(stack_log_t));
+		sStackLog.Magic = stackMAGIC;
+	}
+	++sStackLog.Boots;
+	sStackLog.Check = xRtosStackCheck();				// once per boot, updated incrementally from here
+	bStackValid = 1;
+}
+
+/**
+ * @brief		find (or allocate) the record for a task name
+ * @param[in]	pcName task name
+ * @return		pointer to record or NULL if not found and table full
+ * @note		called with muxStack held
+ */
+static stack_rec_t * psRtosStackFind(const char * pcName) {
+	vRtosStackValidate();
+	stack_rec_t * psFree = NULL;
+	for (int i = 0; i < rtosSTACK_MAX; ++i) {
+		stack_rec_t * psSR = &sStackLog.sRec[i];
+		if (psSR->caName[0] == 0) {
+			if (psFree == NULL)
+				psFree = psSR;
+		} else if (strncmp(psSR->caName, pcName, CONFIG_FREERTOS_MAX_TASK_NAME_LEN) == 0) {
+			return psSR;
+		}
 	}
-	return NULL;
+	if (psFree) {
+		sStackLog.Check ^= xRtosStackCheckWords(psFree, sizeof(stack_rec_t));
+		strncpy(psFree->caName, pcName, CONFIG_FREERTOS_MAX_TASK_NAME_LEN);
+		psFree->MinFree = UINT32_MAX;
+		sStackLog.Check ^= xRtosStackCheckWords(psFree, sizeof(stack_rec_t));
+	} else {
+		sStackLog.Check ^= xRtosStackCheckWords(&sStackLog.Overflow, sizeof(u32_t));
+		++sStackLog.Overflow;
+		sStackLog.Check ^= xRtosStackCheckWords(&sStackLog.Overflow, sizeof(u32_t));
+	}
+	return psFree;
 }
 
-bool bRtosTaskIsIdleTask(TaskHandle_t xHandle) {
-	for (int c = 0; c < portNUM_PROCESSORS; ++c) {
-		 if (xHandle == IdleHandle[c])
-		 	return 1;
+void vRtosStackRegister(const char * pcName, u32_t Depth, bool bStatic) {
+	if (pcName == NULL || *pcName == 0)
+		return;
+	taskENTER_CRITICAL(&muxStack);
+	stack_rec_t * psSR = psRtosStackFind(pcName);
+	if (psSR) {
+		sStackLog.Check ^= xRtosStackCheckWords(psSR, sizeof(stack_rec_t));
+		psSR->Depth = Depth;
+		psSR->bStatic = bStatic;
+		++psSR->Creates;
+		sStackLog.Check ^= xRtosStackCheckWords(psSR, sizeof(stack_rec_t));
 	}
-	return 0;
+	taskEXIT_CRITICAL(&muxStack);
 }
 
-int	xRtosReportTasks(report_t * psR) {
-	int	iRV = 0;										// reset the character output counter
-	if (psR == NULL || psR->sFM.u32Val == 0)
-		return erINV_PARA;
-	if (NumTasks == 0) {								// first time once only
-		for (int c = 0; c < portNUM_PROCESSORS; ++c)
-			IdleHandle[c] = xTaskGetIdleTaskHandleForCore(c);
+/**
+ * @brief		update the lifetime minimum of a task
+ * @param[in]	pcName task name
+ * @param[in]	Free current (high water mark) free stack
+ */
+static void vRtosStackSetFree(const char * pcName, u32_t Free) {
+	taskENTER_CRITICAL(&muxStack);
+	stack_rec_t * psSR = psRtosStackFind(pcName);
+	if (psSR && Free < psSR->MinFree) {
+		sStackLog.Check ^= xRtosStackCheckWords(&psSR->MinFree, sizeof(u32_t));
+		psSR->MinFree = Free;
+		sStackLog.Check ^= xRtosStackCheckWords(&psSR->MinFree, sizeof(u32_t));
 	}
-	memset(sTS, 0, sizeof(sTS));
-	u64_t TotalAdj;
-	// Get up-to-date task status
-#if (portNUM_PROCESSORS > 1)
-	BaseType_t btRV = xRtosSemaphoreTake(&shTaskInfo, portMAX_DELAY);
-#endif
+	taskEXIT_CRITICAL(&muxStack);
+}
 
-	u64_t TotalRem;										// Used to calculate RTOS internal use
-	NumTasks = uxTaskGetSystemState(sTS, configFR_MAX_TASKS, &TotalRem);
-	IF_myASSERT(debugPARAM, INRANGE(1, NumTasks, configFR_MAX_TASKS));
+void vRtosStackUpdate(TaskHandle_t xHandle) {
+	vRtosStackSetFree(pcTaskGetName(xHandle), uxTaskGetStackHighWaterMark(xHandle));
+}
 
-#if (portNUM_PROCESSORS > 1)
-	if (btRV == pdTRUE)
-		xRtosSemaphoreGive(&shTaskInfo);
+void vRtosStackReset(void) {
+	taskENTER_CRITICAL(&muxStack);
+	memset(&sStackLog, 0, sizeof(stack_log_t));
+	sStackLog.Magic = stackMAGIC;
+	sStackLog.Check = xRtosStackCheck();
+	bStackValid = 1;
+	taskEXIT_CRITICAL(&muxStack);
+}
+
+int xRtosReportStacks(report_t * psR) {
+	rtos_snap_t * psSnap = psRtosStatsSnapshot();		// fold in live tasks first, logged values if no memory
+	if (psSnap) {
+		for (int a = 0; a < psSnap->Num; ++a)
+			vRtosStackSetFree(psSnap->sTS[a].pcTaskName, psSnap->sTS[a].usStackHighWaterMark);
+		vRtosStatsRelease(psSnap);
+	}
+	rtos_render_t sRB;
+	if (xRtosRenderStart(&sRB, psR) != erSUCCESS)
+		return erFAILURE;
+	vRtosRenderAdd(&sRB, configFREERTOS_TASKLIST_HDR_DETAIL "S Cre Depth  MinF  Used  Rec Save");
+	vRtosRenderHeader(&sRB);
+	vRtosRenderAdd(&sRB, strNL);
+	stack_rec_t sSR;
+	u32_t Saved = 0;
+	for (int i = 0; i < rtosSTACK_MAX; ++i) {
+		taskENTER_CRITICAL(&muxStack);
+		memcpy(&sSR, &sStackLog.sRec[i], sizeof(stack_rec_t));
+		taskEXIT_CRITICAL(&muxStack);
+		if (sSR.caName[0] == 0)
+			continue;
+		char caName[CONFIG_FREERTOS_MAX_TASK_NAME_LEN + 1];
+		strncpy(caName, sSR.caName, CONFIG_FREERTOS_MAX_TASK_NAME_LEN);
+		caName[CONFIG_FREERTOS_MAX_TASK_NAME_LEN] = 0;
+		vRtosRenderAdd(&sRB, configFREERTOS_TASKLIST_FMT_DETAIL "%c %3u ", caName, sSR.bStatic ? 'S' : 'D', sSR.Creates);
+		if (sSR.Depth == 0 || sSR.MinFree == UINT32_MAX || sSR.MinFree > sSR.Depth) {
+			vRtosRenderAdd(&sRB, "%5lu %5lu     -    -    -" strNL, (unsigned long) sSR.Depth, sSR.MinFree == UINT32_MAX ? 0UL : (unsigned long) sSR.MinFree);
+			continue;
+		}
+		u32_t Used = sSR.Depth - sSR.MinFree;
+		u32_t Rec = (Used + (Used * rtosSTACK_MARGIN) / 100 + 15) & ~15UL;
+		i32_t Save = sSR.Depth - Rec;
+		if (sSR.bStatic && Save > 0)
+			Saved += Save;
+		vRtosRenderAdd(&sRB, "%5lu %5lu %5lu %4lu %4ld" strNL, (unsigned long) sSR.Depth, (unsigned long) sSR.MinFree,
+			(unsigned long) Used, (unsigned long) Rec, (long) Save);
+	}
+	vRtosRenderAdd(&sRB, "Boots=%lu  Untracked=%lu  Static saving=%lu (margin %d%%)", (unsigned long) sStackLog.Boots,
+		(unsigned long) sStackLog.Overflow, (unsigned long) Saved, rtosSTACK_MARGIN);
+	vRtosRenderAdd(&sRB, fmTST(aNL) ? strNLx2 : strNL);
+	return xRtosRenderEnd(&sRB);
+}
 #endif
 
-	TotalRem *= portNUM_PROCESSORS;						// Adjust overhead for all cores
-	TotalAdj = TotalRem / 100ULL;						// will be used to calc % for each task...
-	
-	if (TotalAdj == 0ULL)
-		return 0;
-	Active.U64val = 0;									// reset overall active running total
-#if (portNUM_PROCESSORS > 1)
-	memset(&Cores[0], 0, sizeof(Cores));				// reset time/core running totals
+#if (rtosSCAN_MAX > 0) && (cmakeWRAP_TASKS == 1)
+
+#ifndef rtosSTACK_FILL
+	#define rtosSTACK_FILL			0xA5A5A5A5UL		// tskSTACK_FILL_BYTE replicated to a word
 #endif
-	for (int a = 0; a < NumTasks; ++a) {				// determine value of highest numbered task
-		TaskStatus_t * psTS = &sTS[a];
-		if (psTS->xTaskNumber > MaxNum)
-			MaxNum = psTS->xTaskNumber;
+
+/* Incremental stack scanner. Tasks are added/removed by the create/delete wrappers. Free is the cached
+ * watermark, the scan walks (in slices) from the stack start up to Free and lowers Free at the first
+ * word no longer holding the fill pattern. Each slice runs in a critical section, bounded by
+ * rtosSCAN_WORDS, so a task can not be removed (and stack freed) while being scanned. */
+typedef struct stack_scan_t {
+	TaskHandle_t xHandle;								// NULL = free slot
+	u32_t * pu32Start;									// lowest address, stacks grow downwards
+	u32_t Words;										// stack size
+	u32_t Free;											// cached watermark, words
+	u32_t Scan;											// next word to check
+	u32_t Trip;											// tripwire word index, rtosSCAN_WARN % used
+	u16_t Passes;										// completed scans
+	u8_t bWarned;
+} stack_scan_t;
+
+static stack_scan_t sStackScan[rtosSCAN_MAX] = { 0 };
+static portMUX_TYPE muxScan = portMUX_INITIALIZER_UNLOCKED;
+static TaskHandle_t thStackScan = NULL;
+static u32_t ScanOverflow = 0;
+
+/**
+ * @brief		find the scan table entry of a task
+ * @param[in]	xHandle task handle
+ * @return		pointer to entry, NULL if task not scanned
+ * @note		caller holds muxScan. With appFRTLSP_STACK the TLS pointer holds the entry index + 1
+ * 				(O(1), checked against the handle), else the table is searched
+ */
+static stack_scan_t * psRtosStackScanFind(TaskHandle_t xHandle) {
+#if defined(appFRTLSP_STACK)
+	uintptr_t Idx = (uintptr_t) pvTaskGetThreadLocalStoragePointer(xHandle, appFRTLSP_STACK);
+	if (INRANGE(1, Idx, rtosSCAN_MAX) && sStackScan[Idx - 1].xHandle == xHandle)
+		return &sStackScan[Idx - 1];
+#else
+	for (int i = 0; i < rtosSCAN_MAX; ++i) {
+		if (sStackScan[i].xHandle == xHandle)
+			return &sStackScan[i];
 	}
-	repSET(XLock,sLO);
-	iRV += xReport(psR, "%C", xpfCOL(colourFG_CYAN,0));
-	if (psR->sFM.bTskNum)			iRV += xReport(psR, "T# ");
-	if (psR->sFM.bPrioX)			iRV += xReport(psR, "Pc/Pb ");
-	iRV += xReport(psR, configFREERTOS_TASKLIST_HDR_DETAIL);
-	if (psR->sFM.bState)			iRV += xReport(psR, "S ");
-	if (psR->sFM.bStack)			iRV += xReport(psR, "LowS ");
-#if (portNUM_PROCESSORS > 1)
-	if (psR->sFM.bCore)				iRV += xReport(psR, "X ");
 #endif
-	iRV += xReport(psR, " Util Ticks");
-	if (debugTRACK && psR->sFM.bXtras) iRV += xReport(psR, "|Stack Base|-Task TCB-|   LSP    |");
-	iRV += xReport(psR, "%C" strNL, xpfCOL(attrRESET,0));
+	return NULL;
+}
 
-	u32_t Units, Fracts, TaskMask = 0x1;
-	// display individual task info
-	for (int a = 1; a <= MaxNum; ++a) {
-		TaskStatus_t * psTS = psRtosStatsFindWithNumber(a);
-		if ((psTS == NULL) || (psTS->eCurrentState >= eInvalid) || ((psR->sFM.uCount & TaskMask) == 0) ||
-			(psTS->uxCurrentPriority >= (UBaseType_t) configMAX_PRIORITIES) || (psTS->uxBasePriority >= configMAX_PRIORITIES)) {
-			goto next;
+/**
+ * @brief		add a newly created task to the scan table
+ * @param[in]	xHandle task handle
+ * @param[in]	Depth stack depth as requested at creation
+ */
+static void vRtosStackScanAdd(TaskHandle_t xHandle, u32_t Depth) {
+	if (xHandle == NULL)
+		return;
+	u32_t Words = (Depth * sizeof(StackType_t)) / sizeof(u32_t);
+	taskENTER_CRITICAL(&muxScan);
+	int i;
+	for (i = 0; i < rtosSCAN_MAX; ++i) {
+		stack_scan_t * psSS = &sStackScan[i];
+		if (psSS->xHandle == NULL) {
+			memset(psSS, 0, sizeof(stack_scan_t));
+			psSS->xHandle = xHandle;
+			psSS->pu32Start = (u32_t *) pxTaskGetStackStart(xHandle);
+			psSS->Words = psSS->Free = Words;
+			psSS->Trip = (Words * (100 - rtosSCAN_WARN)) / 100;
+		#if defined(appFRTLSP_STACK)
+			vTaskSetThreadLocalStoragePointer(xHandle, appFRTLSP_STACK, (void *) (uintptr_t) (i + 1));
+		#endif
+			break;
 		}
-		// Check for invalid Core ID, often happens in process of shutting down tasks.
-		if ((psTS->xCoreID != tskNO_AFFINITY) &&
-			INRANGE(0, psTS->xCoreID, portNUM_PROCESSORS-1) == 0) {
-			iRV += xReport(psR, "%d CoreID=%d skipped !!!" strNL, a, psTS->xCoreID);
-			goto next;
-		}
-		if (psR->sFM.bTskNum)		iRV += xReport(psR, "%2u ", psTS->xTaskNumber);
-		if (psR->sFM.bPrioX)		iRV += xReport(psR, "%2u/%2u ", psTS->uxCurrentPriority, psTS->uxBasePriority);
-		iRV += xReport(psR, configFREERTOS_TASKLIST_FMT_DETAIL, psTS->pcTaskName);
-		if (psR->sFM.bState)		iRV += xReport(psR, "%c ", TaskState[psTS->eCurrentState]);
-		if (psR->sFM.bStack)		iRV += xReport(psR, "%4u ", psTS->usStackHighWaterMark);
-	#if (portNUM_PROCESSORS > 1)
-		int c = (psTS->xCoreID == tskNO_AFFINITY) ? 2 : psTS->xCoreID;
-		if (psR->sFM.bCore)		iRV += xReport(psR, "%c ", caMCU[c]);
-	#endif
-		TotalRem -= psTS->ulRunTimeCounter;				// Adjust overhead for this task
-		// Calculate & display individual task utilisation.
-		Units = psTS->ulRunTimeCounter / TotalAdj;
-		Fracts = (((psTS->ulRunTimeCounter * 100) / TotalAdj) + 50) % 100;
-		iRV += xReport(psR, "%2lu.%02lu %#'5llu", Units, Fracts, psTS->ulRunTimeCounter);
-	#if (debugTRACK)
-		if (debugTRACK && psR->sFM.bXtras) {
-			iRV += xReport(psR, " %p %p", pxTaskGetStackStart(psTS->xHandle), psTS->xHandle);
-			iRV += xReport(psR, " %p", pvTaskGetThreadLocalStoragePointer(psTS->xHandle, 1));
+	}
+	if (i == rtosSCAN_MAX)
+		++ScanOverflow;
+	taskEXIT_CRITICAL(&muxScan);
+}
+
+/**
+ * @brief		remove a task about to be deleted from the scan table
+ * @param[in]	xHandle task handle, NULL for current task
+ */
+static void vRtosStackScanDel(TaskHandle_t xHandle) {
+	if (xHandle == NULL)
+		xHandle = xTaskGetCurrentTaskHandle();
+	taskENTER_CRITICAL(&muxScan);
+	stack_scan_t * psSS = psRtosStackScanFind(xHandle);
+	if (psSS)
+		psSS->xHandle = NULL;
+	taskEXIT_CRITICAL(&muxScan);
+}
+
+u32_t xRtosStackFree(TaskHandle_t xHandle) {
+	if (xHandle == NULL)
+		xHandle = xTaskGetCurrentTaskHandle();
+	u32_t Free = UINT32_MAX;
+	taskENTER_CRITICAL(&muxScan);
+	stack_scan_t * psSS = psRtosStackScanFind(xHandle);
+	if (psSS && psSS->Passes)
+		Free = psSS->Free * sizeof(u32_t);
+	taskEXIT_CRITICAL(&muxScan);
+	return Free;
+}
+
+/**
+ * @brief		scan a bounded part of one stack
+ * @param[in]	Idx index in the scan table
+ * @param[out]	pcName buffer, CONFIG_FREERTOS_MAX_TASK_NAME_LEN, receives the task name if warning
+ * @param[out]	pSize receives the stack size in bytes if warning
+ * @return		1 if early warning threshold crossed (first time) else 0
+ * @note		name copied under muxScan, the task could be deleted as soon as it is released
+ */
+static bool bRtosStackScanSlice(int Idx, char * pcName, u32_t * pSize) {
+	bool bWarn = 0;
+	taskENTER_CRITICAL(&muxScan);
+	stack_scan_t * psSS = &sStackScan[Idx];
+	if (psSS->xHandle) {
+		// O(1) tripwire first, catches growth long before the full scan gets there
+		if (psSS->bWarned == 0 && psSS->pu32Start[psSS->Trip] != rtosSTACK_FILL) {
+			psSS->bWarned = 1;
+			memcpy(pcName, pcTaskGetName(psSS->xHandle), CONFIG_FREERTOS_MAX_TASK_NAME_LEN);
+			*pSize = psSS->Words * sizeof(u32_t);
+			bWarn = 1;
 		}
-	#endif
-		if (psR->sFM.bNL)			iRV += xReport(psR, strNL);
-		// For idle task(s) we do not want to add RunTime % to the task or Core RunTime
-		if (bRtosTaskIsIdleTask(psTS->xHandle) == 0) {	// NOT an IDLE task
-			Active.U64val += psTS->ulRunTimeCounter;	// Update total active time
-		#if (portNUM_PROCESSORS > 1)
-			Cores[c].U64val += psTS->ulRunTimeCounter;	// Update core active time
-		#endif
+		u32_t Count = 0;
+		while (psSS->Scan < psSS->Free && Count++ < rtosSCAN_WORDS) {
+			if (psSS->pu32Start[psSS->Scan] != rtosSTACK_FILL) {
+				psSS->Free = psSS->Scan;				// new watermark
+				break;
+			}
+			++psSS->Scan;
+		}
+		if (psSS->Scan >= psSS->Free) {					// pass complete, restart
+			psSS->Scan = 0;
+			++psSS->Passes;
 		}
-next:
-		TaskMask <<= 1;
 	}
+	taskEXIT_CRITICAL(&muxScan);
+	return bWarn;
+}
 
-	Units = Active.U64val / TotalAdj;	// Calculate & display total for "real" tasks utilization.
-	Fracts = ((Active.U64val * 100) / TotalAdj) % 100;
-#if	(portNUM_PROCESSORS > 1)
-	iRV += xReport(psR, "%u Tasks %lu.%02lu%% [", NumTasks, Units, Fracts);
-	for(int c = 0; c <= portNUM_PROCESSORS; ++c) {
-		Units = Cores[c].U64val / TotalAdj;
-		Fracts = ((Cores[c].U64val * 100) / TotalAdj) % 100;
-		iRV += xReport(psR, "%c=%lu.%02lu%c", caMCU[c], Units, Fracts, c < 2 ? ' ' : ']');
+static void vRtosStackScanTask(void * pvPara) {
+	int Idx = 0;
+	char caName[CONFIG_FREERTOS_MAX_TASK_NAME_LEN];
+	u32_t Size;
+	while (1) {
+		u16_t Passes = sStackScan[Idx].Passes;			// stay with a task until a pass completes
+		if (bRtosStackScanSlice(Idx, caName, &Size))
+			SP("stkWARN %.*s used >= %d%% of %lu" strNL, CONFIG_FREERTOS_MAX_TASK_NAME_LEN, caName, rtosSCAN_WARN, Size);
+		if (sStackScan[Idx].xHandle == NULL || sStackScan[Idx].Passes != Passes)
+			Idx = (Idx + 1) % rtosSCAN_MAX;
+		vTaskDelay(pdMS_TO_TICKS(rtosSCAN_PERIOD));
 	}
-#else
-	iRV += xReport(psR, "%u Tasks %lu.%02lu%%", NumTasks, Units, Fracts);
+}
+
+void vRtosStackScanStart(UBaseType_t uxPriority) {
+	if (thStackScan == NULL)
+		xTaskCreate(vRtosStackScanTask, "stkScan", 2048, NULL, uxPriority, &thStackScan);
+}
 #endif
-	// Display remaining ticks as RTOS overhead.
-	Units = TotalRem / TotalAdj;
-	Fracts = ((TotalRem * 100) / TotalAdj) % 100;
-	iRV += xReport(psR, " RTOS %lu.%02lu%%", Units, Fracts);
-	// all done...
-	repSET(XLock,sUL);
-	iRV += xReport(psR, psR->sFM.bNL ? strNLx2 : strNL);
-	return iRV;
+
+// ################################# Per task arena allocator ######################################
+
+#if defined(appFRTLSP_ARENA)
+
+#define arenaALIGN					8
+#define arenaMIN_SHIFT				4					// smallest pool block 16 bytes
+#define arenaHDR_SIZE				((sizeof(rtos_arena_t) + arenaALIGN - 1) & ~(arenaALIGN - 1))
+#define arenaBASE(psA)				((u8_t *) (psA) + arenaHDR_SIZE)
+#define arenaIDLE_ALL				((1U << portNUM_PROCESSORS) - 1)
+#define poolHDR_SIZE				((sizeof(pool_hdr_t) + arenaALIGN - 1) & ~(arenaALIGN - 1))
+#define poolHDR(pvMem)				((pool_hdr_t *) ((u8_t *) (pvMem) - poolHDR_SIZE))
+#define poolHEAP					0xFF				// class of heap fallback blocks
+
+/* Arena header and memory are a single heap allocation, pointed to by the task's TLS pointer. Only the
+ * owning task allocates from its arena, hence no locking. Pool blocks are carved from the arena and kept
+ * on a free list per size class when freed, the list link lives in the free block itself. Pool blocks
+ * that fall back to the heap are also linked into the arena so they are released with it. Every pool
+ * block has a header naming its owning arena and class, so freeing never depends on the caller: a block
+ * freed by another task is left to its owner (counted in Foreign) and released with the arena.
+ * When vTaskDelete() returns the deleted task could still be running on the other core, so the arena is
+ * queued and only freed by the idle hook once the idle task of every core has run since. */
+typedef struct arena_blk_t {
+	struct arena_blk_t * psPrev;
+	struct arena_blk_t * psNext;						// NULL if not linked to an arena
+} arena_blk_t;
+
+typedef struct pool_hdr_t {
+	struct rtos_arena_t * psOwner;						// NULL if heap block of a task without arena
+	u8_t Class;											// pool class or poolHEAP
+} pool_hdr_t;
+
+typedef struct rtos_arena_t {
+	u8_t * pu8Next;										// next free byte
+	u8_t * pu8End;										// first byte beyond arena
+	void * pvFree[rtosARENA_CLASSES];					// free lists per class
+	arena_blk_t sHeap;									// live pool blocks that fell back to the heap
+	struct rtos_arena_t * psDead;						// next arena awaiting release
+	TaskFunction_t pxTaskCode;							// task entry & parameter, see vRtosArenaEntry()
+	void * pvPara;
+	u32_t Size;
+	u32_t Heap;											// count of blocks in sHeap list
+	u32_t Foreign;										// blocks freed by other tasks, left to the arena
+	u8_t Idle;											// cores whose idle hook ran since queued
+} rtos_arena_t;
+
+static rtos_arena_t * psArenaDead = NULL;				// arenas of deleted tasks awaiting release
+static portMUX_TYPE muxArena = portMUX_INITIALIZER_UNLOCKED;
+static u8_t ArenaHooked = 0;
+
+static rtos_arena_t * psRtosArenaGet(TaskHandle_t xHandle) {
+	return (rtos_arena_t *) pvTaskGetThreadLocalStoragePointer(xHandle, appFRTLSP_ARENA);
 }
 
-// ################################### RTOS memory reporting #######################################
+/**
+ * @brief		free an arena, all heap fallback pool blocks still linked to it and the arena itself
+ * @param[in]	psA pointer to arena, no longer reachable from any task
+ */
+static void vRtosArenaFree(rtos_arena_t * psA) {
+	arena_blk_t * psB = psA->sHeap.psNext;
+	while (psB != &psA->sHeap) {
+		arena_blk_t * psN = psB->psNext;
+		vPortFree(psB);
+		psB = psN;
+	}
+	vPortFree(psA);
+}
 
-static u32_t g_HeapBegin;
+/**
+ * @brief		idle hook, frees queued arenas once the idle task of every core has run since queued
+ * @return		true, allow the idle task to sleep
+ */
+static bool bRtosArenaIdle(void) {
+	const u8_t Core = 1U << esp_cpu_get_core_id();
+	rtos_arena_t * psFree = NULL;
+	taskENTER_CRITICAL(&muxArena);
+	rtos_arena_t ** ppsA = &psArenaDead;
+	while (*ppsA) {
+		rtos_arena_t * psA = *ppsA;
+		psA->Idle |= Core;
+		if (psA->Idle == arenaIDLE_ALL) {				// task can not be running anywhere, unlink
+			*ppsA = psA->psDead;
+			psA->psDead = psFree;
+			psFree = psA;
+		} else {
+			ppsA = &psA->psDead;
+		}
+	}
+	taskEXIT_CRITICAL(&muxArena);
+	while (psFree) {									// free outside the critical section
+		rtos_arena_t * psA = psFree;
+		psFree = psA->psDead;
+		vRtosArenaFree(psA);
+	}
+	return true;
+}
 
-void vRtosHeapSetup(void) { g_HeapBegin = xPortGetFreeHeapSize(); }
+/**
+ * @brief		allocate and initialise an arena, register the idle hook on first use
+ * @param[in]	Size arena size in bytes
+ * @return		pointer to arena or NULL if no memory
+ */
+static rtos_arena_t * psRtosArenaNew(u32_t Size) {
+	if (__atomic_exchange_n(&ArenaHooked, 1, __ATOMIC_ACQ_REL) == 0) {
+		for (int c = 0; c < portNUM_PROCESSORS; ++c)
+			esp_register_freertos_idle_hook_for_cpu(bRtosArenaIdle, c);
+	}
+	Size = (Size + arenaALIGN - 1) & ~(arenaALIGN - 1);
+	rtos_arena_t * psA = pvPortMalloc(arenaHDR_SIZE + Size);
+	if (psA == NULL)
+		return NULL;
+	memset(psA, 0, sizeof(rtos_arena_t));
+	psA->pu8Next = arenaBASE(psA);
+	psA->pu8End = psA->pu8Next + Size;
+	psA->sHeap.psPrev = psA->sHeap.psNext = &psA->sHeap;
+	psA->Size = Size;
+	return psA;
+}
 
-int xRtosReportMemory(report_t * psR) {
-	return xReport(psR, "%CFreeRTOS:%C %#'u -> %#'u <- %#'u%s", xpfCOL(colourFG_CYAN,0), xpfCOL(attrRESET,0),
-		xPortGetMinimumEverFreeHeapSize(), xPortGetFreeHeapSize(), g_HeapBegin, fmTST(aNL) ? strNLx2 : strNL);
+/**
+ * @brief		entry point of tasks created with an arena, attaches it before any task code runs
+ * @param[in]	pvPara pointer to arena, holding the real task entry point and parameter
+ */
+static void vRtosArenaEntry(void * pvPara) {
+	rtos_arena_t * psA = pvPara;
+	vTaskSetThreadLocalStoragePointer(NULL, appFRTLSP_ARENA, psA);
+	psA->pxTaskCode(psA->pvPara);
 }
 
-// #################################### RTOS timer reporting #######################################
+int xRtosArenaAttach(TaskHandle_t xHandle, u32_t Size) {
+	if (psRtosArenaGet(xHandle))
+		return erINV_PARA;
+	rtos_arena_t * psA = psRtosArenaNew(Size);
+	if (psA == NULL)
+		return erFAILURE;
+	vTaskSetThreadLocalStoragePointer(xHandle, appFRTLSP_ARENA, psA);
+	return erSUCCESS;
+}
 
 /**
- * @brief	report config & status of timer specified
- * @param	psR pointer to report control structure
- * @param	thTmr timer handle to be reported on
- * @return	size of character output generated
- * @note	DOES specifically lock/unlock console UART
-*/
-int xRtosReportTimer(report_t * psR, TimerHandle_t thTmr) {
-	int iRV;
-	if (halMemorySRAM(thTmr)) {
-		TickType_t tPer = xTimerGetPeriod(thTmr);
-		TickType_t tExp = xTimerGetExpiryTime(thTmr);
-		i32_t tRem = tExp - xTaskGetTickCount();
-		BaseType_t bActive = xTimerIsTimerActive(thTmr); 
-		iRV = xReport(psR, "%C%s%C\t#%lu  Auto=%c  Run=%c", xpfCOL(colourFG_CYAN,0), pcTimerGetName(thTmr), xpfCOL(attrRESET,0),
-			uxTimerGetTimerNumber(thTmr), uxTimerGetReloadMode(thTmr) ? CHR_Y : CHR_N, bActive ? CHR_Y : CHR_N);
-		if (bActive)
-			iRV += xReport(psR, "  tPeriod=%#'lu  tExpiry=%#'lu  tRemain=%#'ld", tPer, tExp, tRem);
-	} else {
-		iRV = xReport(psR, "\t%p Invalid Timer handle", thTmr);
+ * @brief		detach the arena from a task being deleted
+ * @param[in]	xHandle task handle, NULL for current task
+ * @return		pointer to arena, NULL if none attached
+ */
+static rtos_arena_t * psRtosArenaDetach(TaskHandle_t xHandle) {
+	rtos_arena_t * psA = psRtosArenaGet(xHandle);
+	if (psA == NULL)
+		return NULL;
+	vTaskSetThreadLocalStoragePointer(xHandle, appFRTLSP_ARENA, NULL);
+	IF_SP(debugTRACK && (psA->Heap || psA->Foreign), "[%s] arena %lu/%lu used, %lu heap blocks, %lu foreign frees" strNL,
+		pcTaskGetName(xHandle), (u32_t) (psA->pu8Next - arenaBASE(psA)), psA->Size, psA->Heap, psA->Foreign);
+	return psA;
+}
+
+/**
+ * @brief		queue a detached arena, freed by the idle hook once the task can no longer run
+ * @param[in]	psA pointer to arena, NULL ignored
+ */
+static void vRtosArenaRelease(rtos_arena_t * psA) {
+	if (psA == NULL)
+		return;
+	taskENTER_CRITICAL(&muxArena);
+	psA->Idle = 0;
+	psA->psDead = psArenaDead;
+	psArenaDead = psA;
+	taskEXIT_CRITICAL(&muxArena);
+}
+
+static void * pvRtosArenaBump(rtos_arena_t * psA, size_t Size) {
+	Size = (Size + arenaALIGN - 1) & ~(arenaALIGN - 1);
+	if (psA == NULL || Size > (size_t) (psA->pu8End - psA->pu8Next))
+		return NULL;
+	void * pvMem = psA->pu8Next;
+	psA->pu8Next += Size;
+	return pvMem;
+}
+
+void * pvRtosArenaAlloc(size_t Size) { return pvRtosArenaBump(psRtosArenaGet(NULL), Size); }
+
+/**
+ * @brief		map a size to a pool class
+ * @param[in]	Size requested size
+ * @return		class index, rtosARENA_CLASSES if too large for the pools
+ */
+static int xRtosPoolClass(size_t Size) {
+	if (Size <= (1U << arenaMIN_SHIFT))
+		return 0;
+	int Class = (32 - __builtin_clz((u32_t) Size - 1)) - arenaMIN_SHIFT;
+	return (Class < rtosARENA_CLASSES) ? Class : rtosARENA_CLASSES;
+}
+
+void * pvRtosPoolAlloc(size_t Size) {
+	rtos_arena_t * psA = psRtosArenaGet(NULL);
+	int Class = xRtosPoolClass(Size);
+	u8_t * pu8Mem = NULL;
+	if (psA && Class < rtosARENA_CLASSES) {
+		pu8Mem = psA->pvFree[Class];
+		if (pu8Mem)										// pop from free list, header still valid
+			psA->pvFree[Class] = *(void **) pu8Mem;
+		else if ((pu8Mem = pvRtosArenaBump(psA, poolHDR_SIZE + (1U << (Class + arenaMIN_SHIFT)))) != NULL)
+			pu8Mem += poolHDR_SIZE;
 	}
-	if (fmTST(aNL))
-		iRV += xReport(psR, strNL);
-	return iRV;
+	if (pu8Mem == NULL) {								// heap fallback, linked to arena if any
+		arena_blk_t * psB = pvPortMalloc(sizeof(arena_blk_t) + poolHDR_SIZE + Size);
+		if (psB == NULL)
+			return NULL;
+		if (psA) {
+			psB->psPrev = &psA->sHeap;
+			psB->psNext = psA->sHeap.psNext;
+			psA->sHeap.psNext->psPrev = psB;
+			psA->sHeap.psNext = psB;
+			++psA->Heap;
+		} else {
+			psB->psPrev = psB->psNext = NULL;
+		}
+		pu8Mem = (u8_t *) (psB + 1) + poolHDR_SIZE;
+		Class = poolHEAP;
+	}
+	pool_hdr_t * psH = poolHDR(pu8Mem);
+	psH->psOwner = psA;
+	psH->Class = Class;
+	return pu8Mem;
+}
+
+void vRtosPoolFree(void * pvMem, size_t Size) {
+	if (pvMem == NULL)
+		return;
+	pool_hdr_t * psH = poolHDR(pvMem);
+	rtos_arena_t * psA = psH->psOwner;
+	IF_myASSERT(debugPARAM, psH->Class == poolHEAP || psH->Class == xRtosPoolClass(Size));
+	if (psA && psA != psRtosArenaGet(NULL)) {			// owner's lists are not locked, leave to arena
+		__atomic_add_fetch(&psA->Foreign, 1, __ATOMIC_RELAXED);
+		return;
+	}
+	if (psH->Class != poolHEAP) {
+		*(void **) pvMem = psA->pvFree[psH->Class];		// push onto free list
+		psA->pvFree[psH->Class] = pvMem;
+		return;
+	}
+	arena_blk_t * psB = (arena_blk_t *) psH - 1;		// heap fallback
+	if (psA) {											// unlink from arena
+		psB->psPrev->psNext = psB->psNext;
+		psB->psNext->psPrev = psB->psPrev;
+		--psA->Heap;
+	}
+	vPortFree(psB);
 }
+#endif
 
 /* ################################## Task creation/deletion #######################################
  * Need mechanism to dynamically build the bitmapped task mask used for signalling one or more tasks
@@ -429,41 +3636,214 @@ int xRtosReportTimer(report_t * psR, TimerHandle_t thTmr) {
  *	b) Static masks for APP tasks use 0->x, dynamic allocated x<-23, how do we specify static vs dynamic at creation?
  */
 
-static u32_t TaskTracker = 0xFF000000;					// reserve top 8 bits, used internally in FreeRTOS.
+/* Task masks are allocated & released with compare-and-swap, no lock on the create/delete path. Each
+ * update derives the new word from the value it replaces, so a word that changed and changed back in
+ * between can not corrupt it. A mask carries no generation: code holding a stale copy of a released
+ * mask signals whichever task gets it next. Allocation continues downwards from the last mask handed
+ * out before wrapping, which only delays reuse of a just released mask, it does not prevent it. */
+#define rtosTMASK_USED				0x00FFFFFFUL
+
+static u32_t TaskTracker[rtosTSET_WORDS] = { 0 };		// allocated masks, low 24 bits
+static u32_t TaskMaskNext[rtosTSET_WORDS] = { 0 };		// allocation cursor, only a hint
+static u32_t TaskMaskFail = 0;
+static portMUX_TYPE muxTset = portMUX_INITIALIZER_UNLOCKED;
+
+/**
+ * @brief		atomically set/clear bits in a tracker word
+ * @param[in]	W word index
+ * @param[in]	Bits mask bits (low 24 bits only)
+ * @param[in]	bSet true to set, false to clear
+ * @return		true if successful, false if setting bits already set
+ */
+static bool bRtosTaskMaskUpdate(int W, u32_t Bits, bool bSet) {
+	u32_t Old = __atomic_load_n(&TaskTracker[W], __ATOMIC_RELAXED);
+	u32_t New;
+	do {
+		if (bSet && (Old & Bits))
+			return 0;
+		New = bSet ? ((Old | Bits) & rtosTMASK_USED) : (Old & ~Bits);
+	} while (__atomic_compare_exchange_n(&TaskTracker[W], &Old, New, 1, __ATOMIC_ACQ_REL, __ATOMIC_RELAXED) == 0);
+	return 1;
+}
+static EventGroupHandle_t xTsetEG[2][rtosTSET_WORDS] = { 0 };	// [0] = RUN, [1] = DELETE, word 0 unused
+static StaticEventGroup_t sTsetEG[2][rtosTSET_WORDS];
+
+/**
+ * @brief		RUN or DELETE event group of a task set word
+ * @param[in]	bDel false for RUN, true for DELETE
+ * @param[in]	W word index
+ * @return		word 0 the hal groups (shared with _EGxxx() users), else group created on first use
+ */
+static EventGroupHandle_t xRtosTsetGroup(bool bDel, int W) {
+	if (W == 0)
+		return bDel ? TaskDeleteState : TaskRunState;
+	if (xTsetEG[bDel][W] == NULL) {						// created on first use, never deleted
+		taskENTER_CRITICAL(&muxTset);
+		if (xTsetEG[bDel][W] == NULL)
+			xTsetEG[bDel][W] = xEventGroupCreateStatic(&sTsetEG[bDel][W]);
+		taskEXIT_CRITICAL(&muxTset);
+	}
+	return xTsetEG[bDel][W];
+}
+
+u32_t xRtosTaskMaskAlloc(void) {
+	for (int W = 0; W < rtosTSET_WORDS; ++W) {
+		while (1) {
+			u32_t Free = ~__atomic_load_n(&TaskTracker[W], __ATOMIC_ACQUIRE) & rtosTMASK_USED;
+			if (Free == 0)
+				break;									// word full, try next
+			u32_t Below = Free & (__atomic_load_n(&TaskMaskNext[W], __ATOMIC_RELAXED) - 1);
+			if (Below)									// prefer masks below the last one allocated
+				Free = Below;
+			u32_t Bit = 0x80000000UL >> __builtin_clz(Free);
+			if (bRtosTaskMaskUpdate(W, Bit, 1)) {
+				__atomic_store_n(&TaskMaskNext[W], Bit, __ATOMIC_RELAXED);
+				return rtosTMASK(W, Bit);
+			}
+		}												// lost the race for Bit, retry
+	}
+	__atomic_fetch_add(&TaskMaskFail, 1, __ATOMIC_RELAXED);
+	return 0;
+}
+
+void vRtosTaskMaskFree(u32_t Mask) {
+	if (Mask == 0 || rtosTMASK_WORD(Mask) >= rtosTSET_WORDS)
+		return;
+	bRtosTaskMaskUpdate(rtosTMASK_WORD(Mask), rtosTMASK_BITS(Mask), 0);
+}
+
+u32_t xRtosTaskMaskFailures(void) { return __atomic_load_n(&TaskMaskFail, __ATOMIC_RELAXED); }
+
+u32_t xRtosTaskMaskGet(TaskHandle_t xHandle) { return (u32_t) (uintptr_t) pvTaskGetThreadLocalStoragePointer(xHandle, appFRTLSP_EVT_MASK); }
+
+void vRtosTsetAdd(rtos_tset_t * psTS, u32_t Mask) {
+	if (Mask && rtosTMASK_WORD(Mask) < rtosTSET_WORDS)
+		psTS->ebX[rtosTMASK_WORD(Mask)] |= rtosTMASK_BITS(Mask);
+}
+
+void vRtosTsetUpdate(const rtos_tset_t * psTS, bool bDel, bool bSet) {
+	for (int W = 0; W < rtosTSET_WORDS; ++W) {
+		EventBits_t ebX = psTS->ebX[W];
+		if (ebX == 0)
+			continue;
+		if (W == 0) {									// hal groups, via the hal as before
+			if (bDel)
+				halEventUpdateDeleteTasks(ebX, bSet);
+			else
+				halEventUpdateRunTasks(ebX, bSet);
+		} else if (bSet) {
+			xEventGroupSetBits(xRtosTsetGroup(bDel, W), ebX);
+		} else {
+			xEventGroupClearBits(xRtosTsetGroup(bDel, W), ebX);
+		}
+	}
+}
+
+bool bRtosTsetCheck(const rtos_tset_t * psTS, bool bDel, bool bAll) {
+	for (int W = 0; W < rtosTSET_WORDS; ++W) {
+		EventBits_t ebX = psTS->ebX[W];
+		if (ebX == 0)
+			continue;
+		EventBits_t ebS = xEventGroupGetBits(xRtosTsetGroup(bDel, W)) & ebX;
+		if (bAll && ebS != ebX)
+			return 0;
+		if (!bAll && ebS)
+			return 1;
+	}
+	return bAll;
+}
+
+bool bRtosTsetWait(const rtos_tset_t * psTS, bool bDel, TickType_t tW) {
+	TimeOut_t sTO;
+	vTaskSetTimeOutState(&sTO);
+	for (int W = 0; W < rtosTSET_WORDS; ++W) {
+		EventBits_t ebX = psTS->ebX[W];
+		if (ebX == 0)
+			continue;
+		if ((xEventGroupWaitBits(xRtosTsetGroup(bDel, W), ebX, pdFALSE, pdTRUE, tW) & ebX) != ebX)
+			return 0;
+		if (tW != portMAX_DELAY && xTaskCheckForTimeOut(&sTO, &tW) == pdTRUE)
+			tW = 0;										// expired, remaining words checked, not waited on
+	}
+	return 1;
+}
+
+bool bRtosTaskWaitRun(TickType_t tW) {
+	u32_t Mask = xRtosTaskMaskGet(NULL);
+	IF_myASSERT(debugTRACK, Mask != 0);
+	EventBits_t ebX = rtosTMASK_BITS(Mask);
+	return (xEventGroupWaitBits(xRtosTsetGroup(0, rtosTMASK_WORD(Mask)), ebX, pdFALSE, pdTRUE, tW) & ebX) ? 1 : 0;
+}
+
+bool bRtosTaskCheckDelete(void) {
+	u32_t Mask = xRtosTaskMaskGet(NULL);
+	if (Mask == 0)
+		return 0;
+	return (xEventGroupGetBits(xRtosTsetGroup(1, rtosTMASK_WORD(Mask))) & rtosTMASK_BITS(Mask)) ? 1 : 0;
+}
+
+void vRtosTsetTerminate(const rtos_tset_t * psTS) {
+	rtos_tset_t sTS = { 0 };
+	if (psTS == NULL) {
+		vRtosTsetAdd(&sTS, xRtosTaskMaskGet(NULL));
+		psTS = &sTS;
+	}
+#if (halUSE_BSP == 1 && cmakeGUI == 4)
+	// Support for GUI task de-initialization when using LVGL with BSP
+	if (psTS->ebX[0] & taskGUI_MASK)
+		vGuiDeInit();
+#endif
+	vRtosTsetUpdate(psTS, 1, 1);						// first set the delete flag
+	vRtosTsetUpdate(psTS, 0, 1);						// then enable to run to start the  delete
+}
 
 #if defined(appFRTLSP_EVT_MASK) && (appFRTLSP_EVT_MASK > 0)
 TaskHandle_t xTaskCreateWithMask(const task_param_t * psTP, void * const pvPara) {
 	TASK_START(psTP->pcName);
 	IF_myASSERT(debugTRACK, __builtin_popcountl(psTP->xMask) == 1);	// single bit set in mask ?
-#if	(portNUM_PROCESSORS > 1)
-	BaseType_t btRV = xRtosSemaphoreTake(&shTaskInfo, portMAX_DELAY);
+	if (bRtosTaskMaskUpdate(0, rtosTMASK_BITS(psTP->xMask), 1) == 0)	// static masks are always word 0
+		SP("Mask x%08X already allocated" strNL, psTP->xMask);	// Same bit already set
+	TaskFunction_t pxTaskCode = psTP->pxTaskCode;
+	void * pvTaskPara = pvPara;
+#if defined(appFRTLSP_ARENA)
+	rtos_arena_t * psA = psTP->uArenaSize ? psRtosArenaNew(psTP->uArenaSize) : NULL;
+	if (psA) {											// task starts in vRtosArenaEntry() to attach arena
+		psA->pxTaskCode = pxTaskCode;
+		psA->pvPara = pvPara;
+		pxTaskCode = vRtosArenaEntry;
+		pvTaskPara = psA;
+	}
 #endif
-	IF_myASSERT(debugTRACK, (TaskTracker & psTP->xMask) == 0);		// Same bit not already set ?
-	TaskTracker |= psTP->xMask;
 #if (cmakeWRAP_TASKS == 1)
-	TaskHandle_t thRV = __real_xTaskCreateStaticPinnedToCore(psTP->pxTaskCode, psTP->pcName, psTP->usStackDepth, pvPara, psTP->uxPriority, psTP->pxStackBuffer, psTP->pxTaskBuffer, psTP->xCoreID);
+	TaskHandle_t thRV = __real_xTaskCreateStaticPinnedToCore(pxTaskCode, psTP->pcName, psTP->usStackDepth, pvTaskPara, psTP->uxPriority, psTP->pxStackBuffer, psTP->pxTaskBuffer, psTP->xCoreID);
 #else
-	TaskHandle_t thRV = xTaskCreateStaticPinnedToCore(psTP->pxTaskCode, psTP->pcName, psTP->usStackDepth, pvPara, psTP->uxPriority, psTP->pxStackBuffer, psTP->pxTaskBuffer, psTP->xCoreID);
+	TaskHandle_t thRV = xTaskCreateStaticPinnedToCore(pxTaskCode, psTP->pcName, psTP->usStackDepth, pvTaskPara, psTP->uxPriority, psTP->pxStackBuffer, psTP->pxTaskBuffer, psTP->xCoreID);
 #endif
-	vTaskSetThreadLocalStoragePointer(thRV, appFRTLSP_EVT_MASK, (void *)psTP->xMask);
-#if	(portNUM_PROCESSORS > 1)
-	if (btRV == pdTRUE)
-		xRtosSemaphoreGive(&shTaskInfo);
+	vTaskSetThreadLocalStoragePointer(thRV, appFRTLSP_EVT_MASK, (void *) (uintptr_t) psTP->xMask);
+#if (rtosSTACK_MAX > 0)
+	vRtosStackRegister(psTP->pcName, psTP->usStackDepth, 1);
+#endif
+#if (rtosSCAN_MAX > 0) && (cmakeWRAP_TASKS == 1)
+	vRtosStackScanAdd(thRV, psTP->usStackDepth);
 #endif
-	MESSAGE("TH=%p  TT=x%08X  TM=x%08X" strNL, thRV, TaskTracker, pvTaskGetThreadLocalStoragePointer(thRV, appFRTLSP_EVT_MASK));
+#if defined(appFRTLSP_ARENA)
+	if (psA)											// same as vRtosArenaEntry(), in case deleted before it runs
+		vTaskSetThreadLocalStoragePointer(thRV, appFRTLSP_ARENA, psA);
+#endif
+#if (rtosTRACE > 0)
+	vRtosTraceTask(thRV, 1);
+#endif
+	MESSAGE("TH=%p  TT=x%08lX  TM=x%08lX" strNL, thRV, TaskTracker[0] & rtosTMASK_USED, xRtosTaskMaskGet(thRV));
 	return thRV;
 }
 
 void vTaskSetTerminateFlags(EventBits_t uxTaskMask) {
-	if (uxTaskMask == 0)
-		uxTaskMask = (EventBits_t) pvTaskGetThreadLocalStoragePointer(NULL, appFRTLSP_EVT_MASK);
-#if (halUSE_BSP == 1 && cmakeGUI == 4)
-	// Support for GUI task de-initialization when using LVGL with BSP
-	if (uxTaskMask & taskGUI_MASK)
-		vGuiDeInit();
-#endif
-	halEventUpdateDeleteTasks(uxTaskMask, 1);			// first set the delete flag
-	halEventUpdateRunTasks(uxTaskMask, 1);				// then enable to run to start the  delete
+	if (uxTaskMask == 0) {								// current task, mask could be in any word
+		vRtosTsetTerminate(NULL);
+		return;
+	}
+	rtos_tset_t sTS = { .ebX[0] = uxTaskMask };
+	vRtosTsetTerminate(&sTS);
 }
 #endif
 
@@ -472,30 +3852,28 @@ void vTaskSetTerminateFlags(EventBits_t uxTaskMask) {
  * @brief		Wrapper around vTaskDelete
  * @param[in]	xHandle Task handle of the task to be deleted.
  * @note		Assigns unique event mask to FreeRTOS task, updating TaskTracker to mark mask as allocated, storing in task's thread-local storage.
- * 				Includes support for multi-processor systems, conditional handling for a "main" task mask, and ensures thread safety using a semaphore when required.
+ * 				Conditional handling for a "main" task mask, allocation is lock-free so never blocks behind task reporting.
  */
 static void vTaskAllocateMask(TaskHandle_t xHandle) {
 	u32_t Mask;
-#if	(portNUM_PROCESSORS > 1)
-	BaseType_t btRV = xRtosSemaphoreTake(&shTaskInfo, portMAX_DELAY);
+#if (rtosTRACE > 0)
+	vRtosTraceTask(xHandle, 1);
 #endif
 #ifdef rtosFIX_MAIN_MASK
 //	#warning "Using rtosFIX_MAIN_MASK to set 'main' task mask"
 	if (strcmp(pcTaskGetName(xHandle), "main") == 0) {
 		Mask = taskCONSOLE_MASK;						// Use mask as defined 
+		bRtosTaskMaskUpdate(0, Mask, 1);
 	}
 	else
 #endif
 	{
-		// Find next empty slot, mark as allocated, set as "LSP" in new task TCB
-		Mask = 0x80000000 >> __builtin_clzl(~TaskTracker);
+		// Find next empty slot in any word, mark as allocated, set as "LSP" in new task TCB
+		Mask = xRtosTaskMaskAlloc();
+		if (Mask == 0)
+			SP("No task mask for '%s', increase rtosTSET_WORDS" strNL, pcTaskGetName(xHandle));
 	}
-	TaskTracker |= Mask;
-	vTaskSetThreadLocalStoragePointer(xHandle, appFRTLSP_EVT_MASK, (void *)Mask);
-#if	(portNUM_PROCESSORS > 1)
-	if (btRV == pdTRUE)
-		xRtosSemaphoreGive(&shTaskInfo);
-#endif
+	vTaskSetThreadLocalStoragePointer(xHandle, appFRTLSP_EVT_MASK, (void *) (uintptr_t) Mask);
 }
 	
 /**
@@ -514,6 +3892,13 @@ BaseType_t __wrap_xTaskCreate(TaskFunction_t pxTaskCode, const char * const pcNa
 	IF_RP(debugTASKS, "[SP=%p  %s]" strNL, esp_cpu_get_sp(), pcName);
 	BaseType_t btRV = __real_xTaskCreate(pxTaskCode, pcName, usStackDepth, pvParameters, uxPriority, pxCreatedTask);
 	IF_myASSERT(debugTRACK, btRV == pdPASS);
+#if (rtosSTACK_MAX > 0)
+	vRtosStackRegister(pcName, usStackDepth, 0);
+#endif
+#if (rtosSCAN_MAX > 0)
+	if (btRV == pdPASS)
+		vRtosStackScanAdd(*pxCreatedTask, usStackDepth);
+#endif
 	vTaskAllocateMask(*pxCreatedTask);
 	return btRV;
 }
@@ -539,6 +3924,13 @@ BaseType_t __wrap_xTaskCreatePinnedToCore(TaskFunction_t pxTaskCode, const char
 		usStackDepth += usStackDepth >> 2;				/* add 25% to requested stack */
 #endif
 	BaseType_t btRV = __real_xTaskCreatePinnedToCore(pxTaskCode, pcName, usStackDepth, pvParameters, uxPriority, &TempHandle, xCoreID);
+#if (rtosSTACK_MAX > 0)
+	vRtosStackRegister(pcName, usStackDepth, 0);
+#endif
+#if (rtosSCAN_MAX > 0)
+	if (btRV == pdPASS)
+		vRtosStackScanAdd(TempHandle, usStackDepth);
+#endif
 	vTaskAllocateMask(TempHandle);
 	if (pxCreatedTask)
 		*pxCreatedTask = TempHandle;
@@ -562,6 +3954,12 @@ TaskHandle_t __wrap_xTaskCreateStatic(TaskFunction_t pxTaskCode, const char * co
 	IF_RP(debugTASKS, "[SP=%p  %s]" strNL, esp_cpu_get_sp(), pcName);
 	TaskHandle_t thRV = __real_xTaskCreateStatic(pxTaskCode, pcName, usStackDepth, pvParameters, uxPriority, pxStackBuffer, pxTaskBuffer);
 	IF_myASSERT(debugTRACK, thRV != 0);
+#if (rtosSTACK_MAX > 0)
+	vRtosStackRegister(pcName, usStackDepth, 1);
+#endif
+#if (rtosSCAN_MAX > 0)
+	vRtosStackScanAdd(thRV, usStackDepth);
+#endif
 	vTaskAllocateMask(thRV);
 	return thRV;
 }
@@ -584,6 +3982,12 @@ TaskHandle_t __wrap_xTaskCreateStaticPinnedToCore(TaskFunction_t pxTaskCode, con
 	IF_RP(debugTASKS, "[SP=%p  %s]" strNL, esp_cpu_get_sp(), pcName);
 	TaskHandle_t thRV = __real_xTaskCreateStaticPinnedToCore(pxTaskCode, pcName, usStackDepth, pvParameters, uxPriority, pxStackBuffer, pxTaskBuffer, xCoreID);
 	IF_myASSERT(debugTRACK, thRV != 0);
+#if (rtosSTACK_MAX > 0)
+	vRtosStackRegister(pcName, usStackDepth, 1);
+#endif
+#if (rtosSCAN_MAX > 0)
+	vRtosStackScanAdd(thRV, usStackDepth);
+#endif
 	vTaskAllocateMask(thRV);
 	return thRV;
 }
@@ -597,15 +4001,48 @@ TaskHandle_t __wrap_xTaskCreateStaticPinnedToCore(TaskFunction_t pxTaskCode, con
 void __wrap_vTaskDelete(TaskHandle_t xHandle) {
 	char caName[CONFIG_FREERTOS_MAX_TASK_NAME_LEN+1];
 	strncpy(caName, pcTaskGetName(xHandle), CONFIG_FREERTOS_MAX_TASK_NAME_LEN);
-	EventBits_t ebX = (EventBits_t) pvTaskGetThreadLocalStoragePointer(xHandle, appFRTLSP_EVT_MASK);
-	if (ebX) {
-		TaskTracker &= ~(ebX);							// clear task mask
-		halEventUpdateRunTasks(ebX, 0);					// clear RUN and
-		halEventUpdateDeleteTasks(ebX, 0);				// DELete flags
+	u32_t Mask = xRtosTaskMaskGet(xHandle);
+	if (Mask) {
+		rtos_tset_t sTS = { 0 };
+		vRtosTsetAdd(&sTS, Mask);
+		vRtosTsetUpdate(&sTS, 0, 0);					// clear RUN and
+		vRtosTsetUpdate(&sTS, 1, 0);					// DELete flags
+		vRtosTaskMaskFree(Mask);						// then release task mask
 		MESSAGE("[%s] RUN/DELETE flags cleared" strNL, caName);
 	}
 	TASK_STOP(caName);
+#if (rtosTRACE > 0)
+	vRtosTraceTask(xHandle ? xHandle : xTaskGetCurrentTaskHandle(), 0);
+#endif
+#if (rtosSTACK_MAX > 0)
+	vRtosStackUpdate(xHandle);							// capture lifetime minimum before it is lost
+#endif
+#if (rtosSCAN_MAX > 0)
+	vRtosStackScanDel(xHandle);
+#endif
+#if (rtosWAKE > 0)
+	vRtosWakeRelease(NULL, xHandle ? xHandle : xTaskGetCurrentTaskHandle());
+#endif
+#if defined(appFRTLSP_ARENA)
+	rtos_arena_t * psA = psRtosArenaDetach(xHandle);	// all arena & pool memory in one step
+	if (xHandle == NULL || xHandle == xTaskGetCurrentTaskHandle()) {
+		vRtosArenaRelease(psA);							// queue now, real delete never returns
+		psA = NULL;
+	}
+#endif
+#if (portNUM_PROCESSORS > 1)
+	bool bOther = (xHandle && xHandle != xTaskGetCurrentTaskHandle());
+	if (bOther)											// TCB freed now, not while being captured
+		vRtosStatsGateEnter(&SnapDelete, &SnapCapture);
+	__real_vTaskDelete(xHandle);
+	if (bOther)
+		vRtosStatsGateExit(&SnapDelete);
+#else
 	__real_vTaskDelete(xHandle);
+#endif
+#if defined(appFRTLSP_ARENA)
+	vRtosArenaRelease(psA);								// task deleted, may still run on other core
+#endif
 }
 #endif
 
@@ -632,8 +4069,8 @@ void __wrap_vTaskDelete(TaskHandle_t xHandle) {
 void vTaskDumpStack(void * pTCB) {
 	if (pTCB == NULL)
 		pTCB = xTaskGetCurrentTaskHandle();
-	void * pxTOS = (void *) * ((u32_t *) pTCB) ;
-	void * pxStack = (void *) * ((u32_t *) pTCB + 12);		// 48 bytes / 4 = 12
+	void * pxTOS = (void *) (uintptr_t) * ((u32_t *) pTCB) ;
+	void * pxStack = (void *) (uintptr_t) * ((u32_t *) pTCB + 12);		// 48 bytes / 4 = 12
 	PX("Cur SP : %p - Stack HWM : %p" strNL, pxTOS,
 		(u8_t *) pxStack + (uxTaskGetStackHighWaterMark(NULL) * sizeof(StackType_t)));
 }
@@ -651,8 +4088,6 @@ void vTaskDumpStack(void * pTCB) {
 //						/* Ignore the first corrupted PC in case of InstrFetchProhibited */
 //					   (stk_frame.exc_frame && ((XtExcFrame *)stk_frame.exc_frame)->exccause == EXCCAUSE_INSTR_PROHIBITED)));
 
-#include "freertos/task_snapshot.h"
-
 esp_err_t IRAM_ATTR esp_backtrace_print_all_tasks(int depth, bool panic) {
 	u32_t task_count = uxTaskGetNumberOfTasks();
 	TaskSnapshot_t* snapshots = (TaskSnapshot_t*) calloc(task_count * sizeof(TaskSnapshot_t), 1);
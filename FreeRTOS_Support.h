@@ -18,10 +18,37 @@ extern "C" {
 
 // ########################################## Macros ###############################################
 
-#define configFR_MAX_TASKS	24
+#define configFR_MAX_TASKS	24								// expected number of tasks, sizes tracking tables
 
-#define	MALLOC_MARK()	u32_t y,x=xPortGetFreeHeapSize();
-#define	MALLOC_CHECK()	y=xPortGetFreeHeapSize();IF_TRACK(y<x,"%u->%u (%d)" strNL,x,y,y-x);
+#ifndef rtosSEMA_PROFILE
+	#define rtosSEMA_PROFILE		1					// enable contention profiling of xRtosSemaphoreInit() mutexes
+#endif
+#ifndef rtosSEMA_PROF_MAX
+	#define rtosSEMA_PROF_MAX		32					// number of mutexes that can be profiled concurrently
+#endif
+
+#define rtosRT_NOW()			((u64_t) portGET_RUN_TIME_COUNTER_VALUE())
+#ifndef rtosTS_CORE
+	#define rtosTS_CORE(psTS)		((psTS)->xCoreID)		// ESP-IDF TaskStatus_t extension, host build overrides
+#endif
+
+#ifndef rtosLEAK_RING
+	#define rtosLEAK_RING		64						// alloc/free events traced while a scope is open
+#endif
+#ifndef rtosLEAK_SCOPES
+	#define rtosLEAK_SCOPES		4						// concurrently open MALLOC_MARK() scopes
+#endif
+#ifndef rtosLEAK_CALLER
+	#define rtosLEAK_CALLER		2						// return address level of malloc() caller in hook
+#endif
+
+#if defined(CONFIG_HEAP_USE_HOOKS) && (rtosLEAK_RING > 0)
+	#define	MALLOC_MARK()	int iLeakScope = xRtosLeakMark();
+	#define	MALLOC_CHECK()	xRtosLeakCheck(iLeakScope);
+#else
+	#define	MALLOC_MARK()	u32_t y,x=xPortGetFreeHeapSize();
+	#define	MALLOC_CHECK()	y=xPortGetFreeHeapSize();IF_TRACK(y<x,"%u->%u (%d)" strNL,x,y,y-x);
+#endif
 
 #define MESSAGE(mess,...)	IF_PX(debugTRACK && OPT_GET(ioUpDown), mess, ##__VA_ARGS__)
 #define TASK_START(name) 	MESSAGE("[%s] starting" strNL, name)
@@ -35,6 +62,12 @@ extern "C" {
 
 // ######################################### Structures ############################################
 
+#define rtosHIST_BINS				16					// bin 0 = 0, bin N = [2^(N-1) -> 2^N), last bin open ended
+
+typedef struct rtos_hist_t {
+	u32_t Bin[rtosHIST_BINS];
+} rtos_hist_t;
+
 typedef const struct {
 	TaskFunction_t pxTaskCode;
 	const char * const pcName;
@@ -44,6 +77,7 @@ typedef const struct {
 	StaticTask_t * const pxTaskBuffer;
 	const BaseType_t xCoreID;
 	u32_t const xMask;
+	u32_t const uArenaSize;								// per task arena, 0 = none (requires appFRTLSP_ARENA)
 } task_param_t;
 
 // ###################################### Global variables #########################################
@@ -58,27 +92,92 @@ void vApplicationMallocFailedHook(void);
 
 // ##################################### Semaphore support #########################################
 
-#if (appPRODUCTION > 0)
-	#define rtosSEMA_DEBUG			0	
-#else
-	#define rtosSEMA_DEBUG			1
-	extern SemaphoreHandle_t * pSHmatch;
+#ifndef rtosSEMA_DEBUG									// allow tracing to be enabled in production builds
+	#if (appPRODUCTION > 0)
+		#define rtosSEMA_DEBUG		0
+	#else
+		#define rtosSEMA_DEBUG		1
+	#endif
+#endif
+
+#ifndef rtosSEMA_TRACE_SIZE
+	#define rtosSEMA_TRACE_SIZE		32					// trace records per core, must be power of 2
+#endif
+#ifndef rtosSEMA_STACK_DEPTH
+	#if defined(CONFIG_IDF_TARGET_ARCH_XTENSA)
+		#define rtosSEMA_STACK_DEPTH	4					// backtrace PCs captured per trace record
+	#else
+		#define rtosSEMA_STACK_DEPTH	0					// no frame walker, backtrace not captured
+	#endif
+#endif
+#ifndef rtosSEMA_WAIT_MAX
+	#define rtosSEMA_WAIT_MAX		32					// concurrently blocked tasks tracked in wait-for graph
+#endif
+#ifndef rtosSEMA_WAIT_WARN
+	#define rtosSEMA_WAIT_WARN		5000				// mSec, waits exceeding this are reported
+#endif
+#ifndef rtosSEMA_POOL_SIZE
+	#define rtosSEMA_POOL_SIZE		32					// static mutex buffers, 0 to always use the heap
+#endif
+#ifndef rtosSEMA_MON_SIZE
+	#define rtosSEMA_MON_SIZE		32					// monitor table slots, must be power of 2, 75% usable
 #endif
 
 #if	(rtosSEMA_DEBUG > 0)
 
+extern SemaphoreHandle_t * pSHmatch;
+
 /**
  * @brief
  * @param[in]	pSH pointer to semaphore handle
  */
 void xRtosSemaphoreSetMatch(SemaphoreHandle_t * Match);
 
+/**
+ * @brief		register (or update) a semaphore for TAKE/GIVE/INIT/DEL tracing
+ * @param[in]	pSH pointer to semaphore handle, need not be initialised yet
+ * @param[in]	Level trace level for this semaphore, 0 to follow the global ioFRlevel option
+ * @return		erSUCCESS, erINV_PARA or erFAILURE if the monitor table is full
+ */
+int xRtosSemaphoreMonitor(SemaphoreHandle_t * pSH, int Level);
+
+/**
+ * @brief		stop tracing a semaphore
+ * @param[in]	pSH pointer to semaphore handle
+ * @return		erSUCCESS or erFAILURE if not registered
+ */
+int xRtosSemaphoreUnmonitor(SemaphoreHandle_t * pSH);
+
+struct report_t;
+/**
+ * @brief		list all semaphores registered for tracing with their trace levels
+ * @param[in]	psRprt pointer to report control structure
+ * @return		size of character output generated
+ */
+int xRtosReportSemaphoreMonitor(struct report_t * psRprt);
+
+/**
+ * @brief		decode & display all semaphore trace records buffered since the previous drain
+ * @note		called periodically by the drain task, can also be called directly from a console command
+ */
+void vRtosSemaphoreTraceDrain(void);
+
+/**
+ * @brief		create the low priority monitor task
+ * @param[in]	uxPriority priority of the monitor task, normally just above IDLE
+ * @note		periodically drains the semaphore trace buffers and checks the wait-for graph,
+ * 				reporting deadlock cycles and waits exceeding rtosSEMA_WAIT_WARN with the holder chain
+ */
+void vRtosSemaphoreTraceStart(UBaseType_t uxPriority);
+
 #endif
 
 /**
  * @brief
  * @param[in]	pSH pointer to semaphore handle
  * @return		newly initialized semaphore handle
+ * @note		mutex taken from static pool (rtosSEMA_POOL_SIZE) before falling back to the heap
+ * 				handle published with CAS, if already initialised by another task the existing handle is returned
  */
 SemaphoreHandle_t xRtosSemaphoreInit(SemaphoreHandle_t * pSH);
 
@@ -100,6 +199,7 @@ BaseType_t xRtosSemaphoreGive(SemaphoreHandle_t * pSH);
 /**
  * @brief
  * @param[in]	pSH pointer to semaphore handle
+ * @note		handle storage cleared atomically, pool slot (if any) returned for reuse
  */
 void vRtosSemaphoreDelete(SemaphoreHandle_t * pSH);
 
@@ -110,23 +210,721 @@ void vRtosSemaphoreDelete(SemaphoreHandle_t * pSH);
  */
 BaseType_t xRtosSemaphoreCheckCurrent(SemaphoreHandle_t * pSH);
 
+// ################################### Adaptive mutex support ######################################
+
+#ifndef rtosAMUX_SPIN_INIT
+	#define rtosAMUX_SPIN_INIT		2000				// initial spin budget, CPU cycles
+#endif
+#ifndef rtosAMUX_SPIN_MIN
+	#define rtosAMUX_SPIN_MIN		200
+#endif
+#ifndef rtosAMUX_SPIN_MAX
+	#define rtosAMUX_SPIN_MAX		20000
+#endif
+
+/* Adaptive mutex for short critical sections shared across cores. Zero initialise, the underlying
+ * mutex is created on first use via xRtosSemaphoreInit() and hence profiled/traced like any other */
+typedef struct rtos_amutex_t {
+	SemaphoreHandle_t shMutex;							// blocking fallback, priority inheritance
+	u32_t SpinLimit;									// adaptive spin budget, CPU cycles
+	u32_t Spun;											// takes satisfied while spinning
+	u32_t Failed;										// spins abandoned, fell back to blocking
+	u32_t Direct;										// takes satisfied via the standard (blocking) path
+} rtos_amutex_t;
+
+/**
+ * @brief		take adaptive mutex, spinning while holder is running on another core before blocking
+ * @param[in]	psAM pointer to adaptive mutex
+ * @param[in]	tW number of ticks to wait
+ * @return		pdTRUE is taken else pdFALSE
+ * @note		spin budget adapts per mutex, grows on successful spins and halves on failed spins
+ */
+BaseType_t xRtosAMutexTake(rtos_amutex_t * psAM, TickType_t tW);
+
+/**
+ * @brief
+ * @param[in]	psAM pointer to adaptive mutex
+ * @return		pdTRUE is released else pdFALSE
+ */
+BaseType_t xRtosAMutexGive(rtos_amutex_t * psAM);
+
+/**
+ * @brief
+ * @param[in]	psAM pointer to adaptive mutex
+ */
+void vRtosAMutexDelete(rtos_amutex_t * psAM);
+
+struct report_t;
+/**
+ * @brief		report spin/block statistics of an adaptive mutex
+ * @param[in]	psRprt pointer to report control structure
+ * @param[in]	psAM pointer to adaptive mutex
+ * @param[in]	pcName name to identify the mutex
+ * @return		size of character output generated
+ */
+int xRtosReportAMutex(struct report_t * psRprt, rtos_amutex_t * psAM, const char * pcName);
+
+// ################################### Reader/Writer lock support ##################################
+
+/* Reader/writer lock, zero initialise (optionally set bReaderPref) and use, kernel objects are created
+ * on first use. Writer preference (default) holds off new readers once a writer is waiting, which
+ * prevents writer starvation but means a task must not recursively take the read lock. The writer
+ * mutex is created via xRtosSemaphoreInit() so can be profiled/monitored as &lock.shWriter */
+typedef struct rtos_rwlock_t {
+	u32_t State;										// reader count & writer flags
+	SemaphoreHandle_t shWriter;							// serialises writers, priority inheritance
+	SemaphoreHandle_t shDrain;							// last reader out wakes pending writer
+	StaticSemaphore_t ssDrain;
+	u8_t Init;
+	u8_t bReaderPref;									// 1 = readers not held off by pending writer
+	u32_t ReadTakes, ReadWaits;
+	u32_t WriteTakes, WriteWaits;
+} rtos_rwlock_t;
+
+/**
+ * @brief		take shared (read) access
+ * @param[in]	psRW pointer to reader/writer lock
+ * @param[in]	tW number of ticks to wait
+ * @return		pdTRUE is taken else pdFALSE
+ * @note		from ISR only succeeds if no waiting required
+ */
+BaseType_t xRtosRWLockTakeRead(rtos_rwlock_t * psRW, TickType_t tW);
+
+/**
+ * @brief		release shared (read) access
+ * @param[in]	psRW pointer to reader/writer lock
+ * @return		pdTRUE is released else pdFALSE
+ */
+BaseType_t xRtosRWLockGiveRead(rtos_rwlock_t * psRW);
+
+/**
+ * @brief		take exclusive (write) access
+ * @param[in]	psRW pointer to reader/writer lock
+ * @param[in]	tW number of ticks to wait
+ * @return		pdTRUE is taken else pdFALSE
+ * @note		not allowed from ISR
+ */
+BaseType_t xRtosRWLockTakeWrite(rtos_rwlock_t * psRW, TickType_t tW);
+
+/**
+ * @brief		release exclusive (write) access
+ * @param[in]	psRW pointer to reader/writer lock
+ * @return		pdTRUE is released else pdFALSE
+ */
+BaseType_t xRtosRWLockGiveWrite(rtos_rwlock_t * psRW);
+
+/**
+ * @brief
+ * @param[in]	psRW pointer to reader/writer lock, must not be held
+ */
+void vRtosRWLockDelete(rtos_rwlock_t * psRW);
+
+struct report_t;
+/**
+ * @brief		report state and wait/take statistics of a reader/writer lock
+ * @param[in]	psRprt pointer to report control structure
+ * @param[in]	psRW pointer to reader/writer lock
+ * @param[in]	pcName name to identify the lock
+ * @return		size of character output generated
+ */
+int xRtosReportRWLock(struct report_t * psRprt, rtos_rwlock_t * psRW, const char * pcName);
+
+// ################################# Task notification signalling ##################################
+
+#ifndef rtosSIGNAL
+	#define rtosSIGNAL				1					// 1 = enable notification signals, 0 if no slot to spare
+#endif
+
+#if (rtosSIGNAL > 0)
+
+#ifndef rtosSIGNAL_INDEX
+	#define rtosSIGNAL_INDEX		(configTASK_NOTIFICATION_ARRAY_ENTRIES - 1)	// notification slot used
+#endif
+
+/* Index 0 is used by xTaskNotifyGive()/ulTaskNotifyTake() & friends (and IDF components), sharing it
+ * would let those consume or corrupt signal bits. Stock IDF has a single entry, raise the number of
+ * entries (CONFIG_FREERTOS_TASK_NOTIFICATION_ARRAY_ENTRIES) or build with rtosSIGNAL=0 */
+#if (rtosSIGNAL_INDEX < 1) || (rtosSIGNAL_INDEX >= configTASK_NOTIFICATION_ARRAY_ENTRIES)
+	#error "rtosSIGNAL requires a dedicated task notification index >= 1 !!!"
+#endif
+
+/* Lightweight ISR -> task signal built on direct to task notifications, no queue involved. Each signal
+ * owns one or more bits in the notification value of the target task, so a task can wait on several
+ * signals (sources) in one call. An optional count accumulates events between wakeups. From an ISR
+ * the required yield is only recorded, call vRtosSignalISRExit() once as the last step of the ISR. */
+typedef struct rtos_signal_t {
+	TaskHandle_t thTask;								// task to be signalled
+	u32_t Mask;											// bit(s) in notification value
+	u32_t Count;										// events since last consumed
+	u32_t Sets;											// total SET calls
+	u32_t Wakes;										// SETs that resulted in the task consuming the signal
+	u64_t tSet;											// runtime counter at first SET since last wake
+	u64_t tLatSum, tLatMax;								// SET -> task running latency
+	rtos_hist_t sLat;
+} rtos_signal_t;
+
+/**
+ * @brief		initialise a signal
+ * @param[in]	psSig pointer to signal
+ * @param[in]	thTask task to be signalled, NULL for current task
+ * @param[in]	Mask bit(s) used in the notification value, must be unique per task
+ */
+void vRtosSignalInit(rtos_signal_t * psSig, TaskHandle_t thTask, u32_t Mask);
+
+/**
+ * @brief		set signal bit(s) and add to the event count, task or ISR context
+ * @param[in]	psSig pointer to signal
+ * @param[in]	Count number of events to add, 0 to only set the bit(s)
+ * @return		pdTRUE if notification sent else pdFALSE
+ * @note		from ISR does not yield, call vRtosSignalISRExit() before returning from the ISR
+ */
+BaseType_t xRtosSignalSet(rtos_signal_t * psSig, u32_t Count);
+
+/**
+ * @brief		yield once if any signal set during this ISR unblocked a higher priority task
+ */
+void vRtosSignalISRExit(void);
+
+/**
+ * @brief		wait for one or more signals
+ * @param[in]	psSig array of pointers to signals, all must target the calling task
+ * @param[in]	Num number of signals in the array
+ * @param[in]	tW number of ticks to wait
+ * @return		mask of signal bits received (and cleared), 0 if timed out
+ */
+u32_t xRtosSignalWait(rtos_signal_t * psSig[], int Num, TickType_t tW);
+
+/**
+ * @brief		consume the accumulated event count of a signal
+ * @param[in]	psSig pointer to signal
+ * @return		number of events since last called
+ */
+u32_t xRtosSignalCount(rtos_signal_t * psSig);
+
+struct report_t;
+/**
+ * @brief		report SET/wake counts and SET -> task running latency of a signal
+ * @param[in]	psRprt pointer to report control structure
+ * @param[in]	psSig pointer to signal
+ * @param[in]	pcName name to identify the signal
+ * @return		size of character output generated
+ * @note		latency in runtime counter units, compare with the Wake line of xRtosReportSemaphores()
+ */
+int xRtosReportSignal(struct report_t * psRprt, rtos_signal_t * psSig, const char * pcName);
+
+#endif
+
+// ################################### Wake-up latency ############################################
+
+/* Optional measurement of handoff latency, from xRtosSemaphoreGive()/_EGset() to the woken waiter
+ * running. Waiters register while blocked, the give/set path stamps them, the task switch-in hook
+ * (FreeRTOS_Trace.h injected in the kernel with cmakeWAKE) records when the waiter actually runs. Without
+ * the hook the time the blocking call returns is used. Split same core vs cross core wakeups. */
+#ifndef rtosWAKE
+	#define rtosWAKE				0					// 1 = enable wake latency instrumentation
+#endif
+#ifndef rtosWAKE_WAITERS
+	#define rtosWAKE_WAITERS		16					// concurrently blocked waiters tracked
+#endif
+#ifndef rtosWAKE_PRIMS
+	#define rtosWAKE_PRIMS			16					// semaphores/event groups with statistics
+#endif
+#ifndef rtosWAKE_TASKS
+	#define rtosWAKE_TASKS			32					// woken tasks with statistics
+#endif
+
+#if (rtosWAKE > 0)
+/**
+ * @brief		stamp waiters blocked on a primitive, called on the give/set path before the handoff
+ * @param[in]	pvKey semaphore or event group handle
+ */
+void vRtosWakeGive(const void * pvKey);
+
+/**
+ * @brief		record the first switch-in of a stamped waiter, called from the task switch-in hook
+ */
+void vRtosWakeSwitchIn(void);
+
+/**
+ * @brief		instrumented xEventGroupSetBits()
+ */
+EventBits_t xRtosEventGroupSet(EventGroupHandle_t xEG, EventBits_t ebX);
+
+/**
+ * @brief		instrumented xEventGroupWaitBits()
+ */
+EventBits_t xRtosEventGroupWait(EventGroupHandle_t xEG, EventBits_t ebX, BaseType_t bClear, BaseType_t bAll, TickType_t tW);
+
+struct report_t;
+/**
+ * @brief		report wake latency per primitive & per task, same vs cross core
+ * @param[in]	psRprt pointer to report control structure
+ * @return		size of character output generated
+ * @note		latency in runtime counter units, histograms included if bXtras set
+ */
+int xRtosReportWake(struct report_t * psRprt);
+#endif
+
 // ################################### Task status manipulation ####################################
 
-#define _EGset(EG,ebX)					xEventGroupSetBits(EG,ebX)
+#if (rtosWAKE > 0)
+	#define _EGset(EG,ebX)				xRtosEventGroupSet(EG,ebX)
+#else
+	#define _EGset(EG,ebX)				xEventGroupSetBits(EG,ebX)
+#endif
 #define _EGclear(EG,ebX)				xEventGroupClearBits(EG,ebX)
 #define _EGget(EG,ebX)					(xEventGroupGetBits(EG) & (ebX))
 #define _EGcheckAny(EG,ebX)				(xEventGroupGetBits(EG) & (ebX) ? 1 : 0)			// ONE or more match
 #define _EGcheck(EG,ebX)				((xEventGroupGetBits(EG) & (ebX)) == (ebX) ? 1 : 0)	// ALL must match
-#define _EGwait(EG,ebX, ttW)			((xEventGroupWaitBits(EG,(ebX),pdFALSE,pdTRUE,ttW) & (ebX)) == (ebX))
+#if (rtosWAKE > 0)
+	#define _EGwait(EG,ebX, ttW)		((xRtosEventGroupWait(EG,(ebX),pdFALSE,pdTRUE,ttW) & (ebX)) == (ebX))
+#else
+	#define _EGwait(EG,ebX, ttW)		((xEventGroupWaitBits(EG,(ebX),pdFALSE,pdTRUE,ttW) & (ebX)) == (ebX))
+#endif
+
+/* Task masks beyond the 24 usable bits of a single EventBits_t. A task mask is encoded as the word
+ * index in the top (FreeRTOS reserved) 8 bits and a single bit in the low 24 bits, so word 0 masks are
+ * identical to the legacy EventBits_t masks. Word 0 uses the hal TaskRunState & TaskDeleteState groups,
+ * so _EGxxx() users and task sets see the same flags, every further word has its own RUN & DELETE
+ * event groups. A task only waits on its own bit,
+ * always in a single group, so run/delete control never polls multiple groups. */
+#ifndef rtosTSET_WORDS
+	#define rtosTSET_WORDS			4					// 24 tasks per word
+#endif
+#define rtosTSET_BITS				24
+#define rtosTMASK_WORD(M)			((u32_t) (M) >> rtosTSET_BITS)
+#define rtosTMASK_BITS(M)			((EventBits_t) (M) & ((1UL << rtosTSET_BITS) - 1UL))
+#define rtosTMASK(W,B)				(((u32_t) (W) << rtosTSET_BITS) | (B))
+
+typedef struct rtos_tset_t { EventBits_t ebX[rtosTSET_WORDS]; } rtos_tset_t;
+
+/**
+ * @brief		allocate a unique task mask, lock-free
+ * @return		encoded task mask, 0 if all rtosTSET_WORDS * 24 masks in use
+ */
+u32_t xRtosTaskMaskAlloc(void);
+
+/**
+ * @brief		return a task mask to the pool
+ * @param[in]	Mask encoded task mask
+ * @note		masks carry no generation, reuse is only delayed. Copies held elsewhere must be
+ * 				discarded before the mask is freed
+ */
+void vRtosTaskMaskFree(u32_t Mask);
+
+/**
+ * @brief		retrieve the encoded mask of a task
+ * @param[in]	xHandle task handle, NULL for current task
+ * @return		encoded task mask, 0 if none allocated
+ */
+u32_t xRtosTaskMaskGet(TaskHandle_t xHandle);
+
+/**
+ * @brief		number of times xRtosTaskMaskAlloc() found all masks in use
+ * @return		allocation failure count
+ */
+u32_t xRtosTaskMaskFailures(void);
+
+/**
+ * @brief		add an encoded task mask to a multi word task set
+ * @param[in]	psTS pointer to task set
+ * @param[in]	Mask encoded task mask
+ */
+void vRtosTsetAdd(rtos_tset_t * psTS, u32_t Mask);
+
+/**
+ * @brief		set/clear RUN or DELETE flags of all tasks in a set
+ * @param[in]	psTS pointer to task set
+ * @param[in]	bDel false for RUN, true for DELETE flags
+ * @param[in]	bSet true to set, false to clear
+ */
+void vRtosTsetUpdate(const rtos_tset_t * psTS, bool bDel, bool bSet);
+
+/**
+ * @brief		check RUN or DELETE flags of tasks in a set, multi word equivalent of _EGcheck()/_EGcheckAny()
+ * @param[in]	psTS pointer to task set
+ * @param[in]	bDel false for RUN, true for DELETE flags
+ * @param[in]	bAll true if ALL must be set, false if ONE or more
+ * @return		true if condition met
+ */
+bool bRtosTsetCheck(const rtos_tset_t * psTS, bool bDel, bool bAll);
+
+/**
+ * @brief		wait for ALL RUN or DELETE flags in a set, multi word equivalent of _EGwait()
+ * @param[in]	psTS pointer to task set
+ * @param[in]	bDel false for RUN, true for DELETE flags
+ * @param[in]	tW maximum ticks to wait, shared across the words waited on
+ * @return		true if all flags set within tW
+ * @note		blocks on each word's group in turn, flags are not cleared so the order does not matter
+ */
+bool bRtosTsetWait(const rtos_tset_t * psTS, bool bDel, TickType_t tW);
+
+/**
+ * @brief		wait for the calling task's own RUN flag
+ * @param[in]	tW maximum ticks to wait
+ * @return		true if RUN flag set
+ */
+bool bRtosTaskWaitRun(TickType_t tW);
+
+/**
+ * @brief		check the calling task's own DELETE flag
+ * @return		true if task should terminate
+ */
+bool bRtosTaskCheckDelete(void);
+
+/**
+ * @brief		multi word equivalent of vTaskSetTerminateFlags()
+ * @param[in]	psTS pointer to task set, NULL for current task
+ */
+void vRtosTsetTerminate(const rtos_tset_t * psTS);
 
 // ################################### Task status reporting #######################################
 
+#ifndef rtosRENDER_BUF_SIZE
+	#define rtosRENDER_BUF_SIZE		2048				// reports formatted in memory, emitted in one write
+#endif
+#ifndef rtosSTATS_RESERVE
+	#define rtosSTATS_RESERVE		(configFR_MAX_TASKS + 16)	// task status entries per capture buffer, first use
+#endif
+#ifndef rtosSTATS_GROW
+	#define rtosSTATS_GROW			8					// headroom added when a capture buffer is grown
+#endif
+#ifndef rtosSTATS_SLOTS
+	#define rtosSTATS_SLOTS			2					// capture buffers, snapshots owned concurrently
+#endif
+#ifndef rtosSTATS_WINDOW
+	#define rtosSTATS_WINDOW		10					// seconds, default utilisation sample interval
+#endif
+#ifndef rtosSTATS_ALPHA
+	#define rtosSTATS_ALPHA			25					// percent, EWMA weight of the newest interval
+#endif
+
+enum { rtosUTIL_CUMULATIVE, rtosUTIL_WINDOW, rtosUTIL_EWMA };
+
+/**
+ * @brief		select how xRtosReportTasks() calculates task, core & RTOS utilisation
+ * @param[in]	Mode rtosUTIL_CUMULATIVE (since boot), rtosUTIL_WINDOW (last interval) or rtosUTIL_EWMA
+ * @param[in]	Window interval in seconds, 0 to leave unchanged
+ * @param[in]	Alpha EWMA weight (1-100%) of the newest interval, 0 to leave unchanged
+ * @note		interval values only available once bRtosStatsUpdateHook() has taken 2 samples
+ */
+void vRtosStatsSetMode(int Mode, u32_t Window, u32_t Alpha);
+
+/**
+ * @brief		take a new utilisation sample if the interval has elapsed
+ * @return		1 if a new sample was taken else 0
+ * @note		call regularly (eg once a second) from task context, not from the tick hook/ISR
+ */
 bool bRtosStatsUpdateHook(void);
+
 struct report_t;
 int	xRtosReportTasks(struct report_t * psRprt);
+
+#ifndef rtosHEAP_TASKS
+	#define rtosHEAP_TASKS			32					// tasks (incl deleted) with heap accounting
+#endif
+
+#if defined(CONFIG_HEAP_USE_HOOKS) && (rtosLEAK_RING > 0)
+/**
+ * @brief		open a leak detection scope for the current task, used via MALLOC_MARK()
+ * @return		scope number or erFAILURE if all rtosLEAK_SCOPES in use
+ */
+int xRtosLeakMark(void);
+
+/**
+ * @brief		close scope, report allocations by this task since the mark that were not freed
+ * @param[in]	iScope scope number as returned by xRtosLeakMark()
+ * @return		number of unmatched allocations or erINV_PARA
+ * @note		blocks freed by other tasks are reported as leaked
+ */
+int xRtosLeakCheck(int iScope);
+#endif
+
+#if defined(CONFIG_HEAP_TASK_TRACKING)
+/**
+ * @brief		sample live heap bytes & blocks per task, resynchronising the running totals
+ * @note		also called from bRtosStatsUpdateHook() and xRtosReportMemory()
+ */
+void vRtosHeapSample(void);
+#endif
+
+/**
+ * @brief		report FreeRTOS heap, mutex pool, per region fragmentation and per task heap usage
+ * @param[in]	psRprt pointer to report control structure
+ * @return		size of character output generated
+ * @note		per task usage requires CONFIG_HEAP_TASK_TRACKING, tasks selected as per xRtosReportTasks()
+ */
 int xRtosReportMemory(struct report_t * psRprt);
 int xRtosReportTimer(struct report_t * psRprt, TimerHandle_t thTimer);
 
+#ifndef rtosTIMER_MAX
+	#define rtosTIMER_MAX			32					// timers instrumented via the create wrappers
+#endif
+
+/* Timer instrumentation requires the create functions to be wrapped at link time, the component
+ * CMakeLists.txt does not add these, the application must add to its link options:
+ *	-Wl,--wrap=xTimerCreate -Wl,--wrap=xTimerCreateStatic
+ * and define cmakeWRAP_TIMERS=1. Timers created before, or when all rtosTIMER_MAX records are in use,
+ * are not instrumented. */
+#if (cmakeWRAP_TIMERS == 1)
+/**
+ * @brief		delete an instrumented timer, releasing its statistics record
+ * @param[in]	thTimer timer handle
+ * @param[in]	tW ticks to wait for space in the timer command queue
+ * @return		result of xTimerDelete()
+ * @note		xTimerDelete() is a macro so can not be wrapped, use this to free the record. A timer
+ * 				deleted with plain xTimerDelete() leaks its record (reported under its copied name)
+ * 				until a new timer is created at the same address, repeatedly doing so fills the table
+ */
+BaseType_t xRtosTimerDelete(TimerHandle_t thTimer, TickType_t tW);
+
+/**
+ * @brief		queue a probe via the timer command queue, measuring command latency of the daemon
+ * @note		called from bRtosStatsUpdateHook(), latency reflects queue depth & callback load
+ */
+void vRtosTimerProbe(void);
+
+/**
+ * @brief		report callback lateness, execution time & missed periods for all instrumented timers
+ * @param[in]	psRprt pointer to report control structure
+ * @return		size of character output generated
+ * @note		lateness in ticks, execution time & daemon queue latency in runtime counter units
+ */
+int xRtosReportTimers(struct report_t * psRprt);
+
+TimerHandle_t __real_xTimerCreate(const char * const, const TickType_t, const UBaseType_t, void * const, TimerCallbackFunction_t);
+TimerHandle_t __real_xTimerCreateStatic(const char * const, const TickType_t, const UBaseType_t, void * const, TimerCallbackFunction_t, StaticTimer_t *);
+#endif
+
+/* Compact machine readable (CBOR, RFC 8949) equivalents of the task, memory and timer reports. Output
+ * is streamed to the sink via a small staging buffer, the complete document is never built in RAM.
+ * Every report is a CBOR array starting with the schema version and report type:
+ *	Tasks	[ver, 1, TotalRuntime, Cores, [[Num, Name, Pcur, Pbase, State, StackHWM, Core, Runtime], ...]]
+ *			(inner array indefinite length, Core == Cores means no affinity)
+ *	Memory	[ver, 2, MinFree, Free, Begin, PoolUsed, PoolHWM, PoolHeap]
+ *	Timer	[ver, 3, Num, Name, AutoReload, Active, Period, Expiry, Remain]
+ * Timer values in ticks, runtime values in runtime counter units. */
+#define rtosCBOR_SCHEMA				1
+#ifndef rtosCBOR_BUF_SIZE
+	#define rtosCBOR_BUF_SIZE		64					// staging buffer, flushed to sink when full
+#endif
+
+enum { rtosCBOR_TASKS = 1, rtosCBOR_MEMORY, rtosCBOR_TIMER };
+
+typedef int (* rtos_sink_t)(void * pvArg, const u8_t * pu8Buf, size_t Size);
+
+typedef struct rtos_cbor_t {
+	rtos_sink_t pfSink;									// called with each chunk of encoded output
+	void * pvArg;										// passed to sink
+	int iRV;											// total bytes accepted by sink, erFAILURE if sink failed
+	size_t Used;
+	u8_t Buf[rtosCBOR_BUF_SIZE];
+} rtos_cbor_t;
+
+/**
+ * @brief		initialise a CBOR encoder context
+ * @param[in]	psC pointer to encoder context
+ * @param[in]	pfSink function to receive encoded output, return < 0 on error
+ * @param[in]	pvArg argument passed to sink
+ */
+void vRtosCborInit(rtos_cbor_t * psC, rtos_sink_t pfSink, void * pvArg);
+
+/**
+ * @brief		encode status & runtime of all tasks
+ * @param[in]	psC pointer to encoder context
+ * @return		bytes output or erFAILURE
+ */
+int xRtosEncodeTasks(rtos_cbor_t * psC);
+
+/**
+ * @brief		encode FreeRTOS heap & mutex pool status
+ * @param[in]	psC pointer to encoder context
+ * @return		bytes output or erFAILURE
+ */
+int xRtosEncodeMemory(rtos_cbor_t * psC);
+
+/**
+ * @brief		encode config & status of a timer
+ * @param[in]	psC pointer to encoder context
+ * @param[in]	thTimer timer handle
+ * @return		bytes output or erFAILURE
+ */
+int xRtosEncodeTimer(rtos_cbor_t * psC, TimerHandle_t thTimer);
+
+#if (rtosSEMA_PROFILE > 0)
+/**
+ * @brief		report take/contention counts, wait & hold times and holders for all profiled mutexes
+ * @param[in]	psRprt pointer to report control structure
+ * @return		size of character output generated
+ * @note		wait & hold times in runtime counter units, histograms (log2 bins) added if sFM.bXtras set
+ */
+int xRtosReportSemaphores(struct report_t * psRprt);
+
+/**
+ * @brief		reset the profiling counters of all mutexes, mutexes remain attached
+ */
+void vRtosSemaphoreStatsReset(void);
+#endif
+
+// ###################################### Sampling profiler ########################################
+
+#ifndef rtosPROF_SLOTS
+	#define rtosPROF_SLOTS			256					// PC/task entries per core, power of 2, 0 to disable
+#endif
+#ifndef rtosPROF_PROBE
+	#define rtosPROF_PROBE			8					// max slots probed per sample, bounds ISR overhead
+#endif
+
+#if (rtosPROF_SLOTS > 0)
+/**
+ * @brief		sample interrupted PC & current task of this core, registered as tick hook on each core
+ * @note		can also be called from myApplicationTickHook() or a high rate timer ISR
+ */
+void vRtosProfSample(void);
+
+/**
+ * @brief		start (or resume) sampling, registering the per core tick hooks on first call
+ * @param[in]	Div sample every Div ticks, bounds overhead under load
+ * @return		erSUCCESS or erFAILURE if the hooks could not be registered
+ */
+int xRtosProfStart(u16_t Div);
+
+/**
+ * @brief		stop sampling, collected samples are retained
+ */
+void vRtosProfStop(void);
+
+/**
+ * @brief		discard all collected samples
+ */
+void vRtosProfReset(void);
+
+/**
+ * @brief		report sample counts per task with the top N PCs of each
+ * @param[in]	psRprt pointer to report control structure
+ * @param[in]	TopN number of PCs to list per task
+ * @return		size of character output generated
+ * @note		tasks selected as in xRtosReportTasks(), symbolise PCs offline with addr2line against the ELF
+ */
+int xRtosReportProfile(struct report_t * psRprt, int TopN);
+#endif
+
+// ################################### Stack usage tracking ########################################
+
+#ifndef rtosSTACK_MAX
+	#define rtosSTACK_MAX			32					// distinct task names tracked, 0 to disable
+#endif
+#ifndef rtosSTACK_MARGIN
+	#define rtosSTACK_MARGIN		25					// percent, safety margin added to recommendations
+#endif
+
+#if (rtosSTACK_MAX > 0)
+/**
+ * @brief		record the requested stack depth of a task being created
+ * @param[in]	pcName task name, used as persistent key
+ * @param[in]	Depth stack depth as requested at creation
+ * @param[in]	bStatic 1 if stack statically allocated
+ * @note		called from the task create wrappers, records survive soft reboots (no-init RAM)
+ */
+void vRtosStackRegister(const char * pcName, u32_t Depth, bool bStatic);
+
+/**
+ * @brief		update the lifetime minimum free stack of a task
+ * @param[in]	xHandle task handle, NULL for current task
+ * @note		called from __wrap_vTaskDelete() so deleted tasks are captured
+ */
+void vRtosStackUpdate(TaskHandle_t xHandle);
+
+/**
+ * @brief		discard all lifetime stack records
+ */
+void vRtosStackReset(void);
+
+struct report_t;
+/**
+ * @brief		report lifetime minimum free stack and recommended usStackDepth per task
+ * @param[in]	psRprt pointer to report control structure
+ * @return		size of character output generated
+ * @note		recommendation = maximum used + rtosSTACK_MARGIN %, rounded up to 16
+ */
+int xRtosReportStacks(struct report_t * psRprt);
+#endif
+
+#ifndef rtosSCAN_MAX
+	#define rtosSCAN_MAX			32					// tasks with stacks scanned incrementally, 0 to disable
+#endif
+#ifndef rtosSCAN_WORDS
+	#define rtosSCAN_WORDS			64					// words checked per slice
+#endif
+#ifndef rtosSCAN_PERIOD
+	#define rtosSCAN_PERIOD			10					// mSec between slices
+#endif
+#ifndef rtosSCAN_WARN
+	#define rtosSCAN_WARN			85					// percent stack used triggering early warning
+#endif
+
+#if (rtosSCAN_MAX > 0) && (cmakeWRAP_TASKS == 1)
+/**
+ * @brief		create the low priority task incrementally scanning the stacks of all wrapped tasks
+ * @param[in]	uxPriority priority of the scanner task, normally just above IDLE
+ * @note		each slice checks a tripwire word at rtosSCAN_WARN % usage (O(1) early warning) and
+ * 				up to rtosSCAN_WORDS words of the unused stack, refining the cached watermark
+ */
+void vRtosStackScanStart(UBaseType_t uxPriority);
+
+/**
+ * @brief		cached minimum free stack of a task, no stack walk
+ * @param[in]	xHandle task handle, NULL for current task
+ * @return		free stack in bytes, UINT32_MAX if task not scanned or first pass not yet complete
+ * @note		O(1) if the application defines appFRTLSP_STACK (a free thread local storage index),
+ * 				else a linear search of the (rtosSCAN_MAX entry) scan table. Used by the task snapshot
+ * 				instead of the kernel's stack walk
+ */
+u32_t xRtosStackFree(TaskHandle_t xHandle);
+#endif
+
+// ################################# Per task arena allocator ######################################
+
+#if defined(appFRTLSP_ARENA)
+#define rtosARENA_CLASSES			4					// pool block sizes 16, 32, 64 & 128 bytes
+
+/**
+ * @brief		attach an arena to a task, all arena memory is released in one step when task deleted
+ * @param[in]	xHandle task handle, NULL for current task
+ * @param[in]	Size arena size in bytes
+ * @return		erSUCCESS, erFAILURE if no memory or erINV_PARA if task already has an arena
+ * @note		xTaskCreateWithMask() attaches one before the task runs if uArenaSize is non-zero
+ * 				otherwise attach before the task uses the pools, freed shortly after the task is deleted
+ */
+int xRtosArenaAttach(TaskHandle_t xHandle, u32_t Size);
+
+/**
+ * @brief		allocate from the current task's arena, O(1) bump allocation, 8 byte aligned
+ * @param[in]	Size number of bytes
+ * @return		pointer to memory or NULL if arena exhausted (or not attached)
+ * @note		memory can not be freed individually, only released when the task is deleted
+ */
+void * pvRtosArenaAlloc(size_t Size);
+
+/**
+ * @brief		allocate a block from the current task's fixed size pools (16 to 128 bytes)
+ * @param[in]	Size number of bytes, rounded up to the block size
+ * @return		pointer to block, from the heap if too large or arena exhausted, NULL if no memory
+ * @note		O(1), lock-free, only to be used (and freed) by the owning task
+ */
+void * pvRtosPoolAlloc(size_t Size);
+
+/**
+ * @brief		return a block to the pools (or heap) of the task that allocated it
+ * @param[in]	pvMem pointer to block as returned by pvRtosPoolAlloc()
+ * @param[in]	Size size as requested from pvRtosPoolAlloc()
+ * @note		owner and class are taken from the block header, not the calling task. The free lists
+ * 				are not locked, so a block of another task's arena is not reused but left to that arena
+ * 				(counted) and released when the owning task is deleted
+ */
+void vRtosPoolFree(void * pvMem, size_t Size);
+#endif
+
 // ################################## Task creation/deletion #######################################
 
 /**
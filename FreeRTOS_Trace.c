@@ -0,0 +1,182 @@
+//	FreeRTOS_Trace.c - Copyright (c) 2026 Andre M. MAree / KSS Technologies (Pty) Ltd.
+
+#include "hal_platform.h"
+#include "FreeRTOS_Support.h"
+#include "FreeRTOS_Trace.h"
+#include "hal_stdio.h"
+#include "errors_events.h"
+#include "utilitiesX.h"
+
+#include "esp_cpu.h"
+#include "esp_heap_caps.h"
+#include <string.h>
+
+#if (rtosTRACE > 0)
+
+// ########################################### Macros ##############################################
+
+#define	debugFLAG					0xF000
+#define	debugTIMING					(debugFLAG_GLOBAL & debugFLAG & 0x1000)
+#define	debugTRACK					(debugFLAG_GLOBAL & debugFLAG & 0x2000)
+#define	debugPARAM					(debugFLAG_GLOBAL & debugFLAG & 0x4000)
+#define	debugRESULT					(debugFLAG_GLOBAL & debugFLAG & 0x8000)
+
+#define rtosTRACE_VERSION			1
+#define rtosTRACE_HZ				1000000				// runtime counter frequency, esp_timer based
+
+// ######################################## Local structures #######################################
+
+typedef struct __attribute__((packed)) rtos_trec_t {
+	u32_t tStamp;										// low 32 bits of runtime counter, unwrapped by host
+	u8_t Type;
+	u8_t Aux;
+	u16_t Id;
+} rtos_trec_t;
+
+typedef struct rtos_tbuf_t {
+	rtos_trec_t * psBuf;
+	u32_t Size;											// records, power of 2
+	u32_t Head;											// total records written, index = Head & (Size-1)
+} rtos_tbuf_t;
+
+// ######################################## Local variables ########################################
+
+static rtos_tbuf_t sTrace[portNUM_PROCESSORS] = { 0 };
+static u8_t TraceOn = 0;
+static struct { u16_t Num; char Name[CONFIG_FREERTOS_MAX_TASK_NAME_LEN+1]; } sTraceName[rtosTRACE_NAMES] = { 0 };
+static u32_t TraceNameIdx = 0;
+static portMUX_TYPE muxTrace = portMUX_INITIALIZER_UNLOCKED;
+
+// ####################################### Private functions #######################################
+
+static void vRtosTraceName(TaskHandle_t xHandle) {
+	taskENTER_CRITICAL(&muxTrace);
+	int i = TraceNameIdx++ % rtosTRACE_NAMES;			// ring, oldest (probably deleted) names lost first
+	sTraceName[i].Num = uxTaskGetTaskNumber(xHandle);
+	strncpy(sTraceName[i].Name, pcTaskGetName(xHandle), CONFIG_FREERTOS_MAX_TASK_NAME_LEN);
+	taskEXIT_CRITICAL(&muxTrace);
+}
+
+// ####################################### Public functions ########################################
+
+void vRtosTraceEvent(unsigned Type, unsigned Aux, unsigned Id) {
+	if (__atomic_load_n(&TraceOn, __ATOMIC_RELAXED) == 0)
+		return;
+	UBaseType_t uxMask = portSET_INTERRUPT_MASK_FROM_ISR();	// no migration or nested ISR until written
+	rtos_tbuf_t * psTB = &sTrace[esp_cpu_get_core_id()];
+	u32_t Idx = __atomic_fetch_add(&psTB->Head, 1, __ATOMIC_RELAXED);
+	rtos_trec_t * psTR = &psTB->psBuf[Idx & (psTB->Size - 1)];
+	psTR->tStamp = (u32_t) rtosRT_NOW();
+	psTR->Type = Type;
+	psTR->Aux = Aux;
+	psTR->Id = Id;
+	portCLEAR_INTERRUPT_MASK_FROM_ISR(uxMask);
+}
+
+void vRtosTraceTask(void * xHandle, int bCreate) {
+	if (xHandle == NULL)
+		return;
+	if (bCreate)										// keep names even while not recording
+		vRtosTraceName(xHandle);
+	vRtosTraceEvent(bCreate ? rtosTR_TASK_CREATE : rtosTR_TASK_DELETE, 0, uxTaskGetTaskNumber(xHandle));
+}
+
+void vRtosTraceSema(void * pvSema, unsigned Type, unsigned Aux) {
+	vRtosTraceEvent(Type, Aux, ((uintptr_t) pvSema >> 2) & 0xFFFF);	// handles are word aligned
+}
+
+int xRtosTraceStart(unsigned Size, int bPSRAM) {
+	if (sTrace[0].psBuf == NULL) {
+		if (Size == 0)
+			Size = rtosTRACE_SIZE;
+		Size = (Size > 1) ? (1UL << (32 - __builtin_clz((u32_t) Size - 1))) : 2;
+		u32_t Caps = (bPSRAM ? MALLOC_CAP_SPIRAM : MALLOC_CAP_INTERNAL) | MALLOC_CAP_8BIT;
+		for (int c = 0; c < portNUM_PROCESSORS; ++c) {
+			sTrace[c].psBuf = heap_caps_malloc(Size * sizeof(rtos_trec_t), Caps);
+			if (sTrace[c].psBuf == NULL) {
+				while (c-- > 0) {
+					heap_caps_free(sTrace[c].psBuf);
+					sTrace[c].psBuf = NULL;
+				}
+				return erFAILURE;
+			}
+			sTrace[c].Size = Size;
+		}
+		// capture names of tasks created before tracing was started
+		UBaseType_t Num = uxTaskGetNumberOfTasks() + 2;
+		TaskStatus_t * psTS = pvPortMalloc(Num * sizeof(TaskStatus_t));
+		if (psTS) {
+			Num = uxTaskGetSystemState(psTS, Num, NULL);
+			for (UBaseType_t i = 0; i < Num; ++i)
+				vRtosTraceName(psTS[i].xHandle);
+			vPortFree(psTS);
+		}
+	}
+	for (int c = 0; c < portNUM_PROCESSORS; ++c)
+		__atomic_store_n(&sTrace[c].Head, 0, __ATOMIC_RELAXED);
+	__atomic_store_n(&TraceOn, 1, __ATOMIC_RELEASE);
+	return erSUCCESS;
+}
+
+void vRtosTraceStop(void) { __atomic_store_n(&TraceOn, 0, __ATOMIC_RELEASE); }
+
+// ######################################### Reporting #############################################
+
+int xRtosReportTrace(report_t * psR) {
+	int iRV = xReport(psR, "%C%s%C\tRun=%c", xpfCOL(colourFG_CYAN,0), "trace", xpfCOL(attrRESET,0), TraceOn ? CHR_Y : CHR_N);
+	for (int c = 0; c < portNUM_PROCESSORS; ++c) {
+		u32_t Head = __atomic_load_n(&sTrace[c].Head, __ATOMIC_RELAXED);
+		iRV += xReport(psR, "  C%d=%lu/%lu", c, Head, sTrace[c].Size);
+		if (Head > sTrace[c].Size)
+			iRV += xReport(psR, " (lost %lu)", Head - sTrace[c].Size);
+	}
+	if (fmTST(aNL))
+		iRV += xReport(psR, strNL);
+	return iRV;
+}
+
+/* Dump format, one item per line, parsed by tools/rtos_trace2json.py
+ *	#RTOSTRACE <version> <cores> <Hz>
+ *	N <task number> <name>
+ *	R <core> <timestamp> <type> <aux> <id>
+ *	#END
+ */
+int xRtosTraceDump(report_t * psR) {
+	u8_t WasOn = __atomic_exchange_n(&TraceOn, 0, __ATOMIC_ACQ_REL);
+	int iRV = xReport(psR, "#RTOSTRACE %d %d %d" strNL, rtosTRACE_VERSION, portNUM_PROCESSORS, rtosTRACE_HZ);
+	for (int i = 0; i < rtosTRACE_NAMES; ++i) {
+		if (sTraceName[i].Name[0])
+			iRV += xReport(psR, "N %u %s" strNL, sTraceName[i].Num, sTraceName[i].Name);
+	}
+	for (int c = 0; c < portNUM_PROCESSORS; ++c) {
+		rtos_tbuf_t * psTB = &sTrace[c];
+		if (psTB->psBuf == NULL)
+			continue;
+		u32_t Head = psTB->Head;
+		for (u32_t i = (Head > psTB->Size) ? (Head - psTB->Size) : 0; i < Head; ++i) {
+			rtos_trec_t * psTR = &psTB->psBuf[i & (psTB->Size - 1)];
+			iRV += xReport(psR, "R %d %lu %u %u %u" strNL, c, psTR->tStamp, psTR->Type, psTR->Aux, psTR->Id);
+		}
+	}
+	iRV += xReport(psR, "#END" strNL);
+	if (WasOn)
+		__atomic_store_n(&TraceOn, 1, __ATOMIC_RELEASE);
+	return iRV;
+}
+#endif
+
+// ###################################### Task switch hook #########################################
+
+#if (rtosTRACE > 0) || (rtosWAKE > 0)
+void vRtosTraceSwitch(int bIn) {
+#if (rtosWAKE > 0)
+	if (bIn)
+		vRtosWakeSwitchIn();
+#endif
+#if (rtosTRACE > 0)
+	if (__atomic_load_n(&TraceOn, __ATOMIC_RELAXED) == 0)
+		return;
+	vRtosTraceEvent(bIn ? rtosTR_SWITCH_IN : rtosTR_SWITCH_OUT, 0, uxTaskGetTaskNumber(xTaskGetCurrentTaskHandle()));
+#endif
+}
+#endif
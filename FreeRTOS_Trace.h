@@ -0,0 +1,122 @@
+// FreeRTOS_Trace.h
+
+#pragma	once
+
+/* Context switch & event trace recorder. Compact timestamped records are written to a lock-free ring
+ * per core, each ring only written by its own core (ISRs nest via an atomic head increment). Dump with
+ * xRtosTraceDump() and convert to Chrome trace / Perfetto JSON with tools/rtos_trace2json.py
+ *
+ * This header is also force included (-include) into the FreeRTOS kernel sources when cmakeTRACE (or
+ * cmakeWAKE) is enabled, hence only plain C types and no other includes, the kernel picks up the trace
+ * macros below.
+ */
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+// ########################################## Macros ###############################################
+
+#ifndef rtosTRACE
+	#define rtosTRACE				0					// 1 = enable recorder & kernel hooks
+#endif
+#ifndef rtosWAKE
+	#define rtosWAKE				0					// 1 = wake latency, needs the switch-in hook only
+#endif
+#ifndef rtosTRACE_SIZE
+	#define rtosTRACE_SIZE			4096				// default records per core, power of 2
+#endif
+#ifndef rtosTRACE_NAMES
+	#define rtosTRACE_NAMES			64					// task number -> name map entries
+#endif
+
+enum {													// record types
+	rtosTR_SWITCH_IN = 1,								// Id = task number
+	rtosTR_SWITCH_OUT,
+	rtosTR_ISR_ENTER,									// Id = interrupt number
+	rtosTR_ISR_EXIT,
+	rtosTR_TASK_CREATE,									// Id = task number
+	rtosTR_TASK_DELETE,
+	rtosTR_SEM_TAKE,									// Id = semaphore, Aux 0 = request, 1 = taken, 2 = timeout
+	rtosTR_SEM_GIVE,									// Id = semaphore, Aux 1 = from ISR
+};
+
+/* Kernel hooks, only defined on the force include path (ahead of FreeRTOS.h). Where this header follows
+ * FreeRTOS.h the kernel has already supplied its empty defaults, redefining them would only warn. */
+#ifndef INC_FREERTOS_H
+	#if (rtosTRACE > 0) || (rtosWAKE > 0)
+		#define traceTASK_SWITCHED_IN()			vRtosTraceSwitch(1)
+	#endif
+	/* On ESP-IDF the ISR hooks are only called by the port's tick handler, other interrupts are not recorded */
+	#if (rtosTRACE > 0)
+		#define traceTASK_SWITCHED_OUT()		vRtosTraceSwitch(0)
+		#define traceISR_ENTER(n)				vRtosTraceEvent(rtosTR_ISR_ENTER, 0, (unsigned) (n))
+		#define traceISR_EXIT()					vRtosTraceEvent(rtosTR_ISR_EXIT, 0, 0)
+		#define traceISR_EXIT_TO_SCHEDULER()	vRtosTraceEvent(rtosTR_ISR_EXIT, 1, 0)
+	#endif
+#endif
+
+// ################################### Public function prototypes ##################################
+
+/**
+ * @brief		record a task switch, called from the kernel trace hooks
+ * @param[in]	bIn 1 if switched in, 0 if switched out
+ */
+void vRtosTraceSwitch(int bIn);
+
+/**
+ * @brief		add a record to the current core's ring
+ * @param[in]	Type record type rtosTR_xxx
+ * @param[in]	Aux type specific qualifier
+ * @param[in]	Id task number, interrupt number or semaphore id
+ * @note		callable from task & ISR context, no effect unless recording
+ */
+void vRtosTraceEvent(unsigned Type, unsigned Aux, unsigned Id);
+
+/**
+ * @brief		record task creation/deletion, capturing the name of a new task
+ * @param[in]	xHandle task handle
+ * @param[in]	bCreate 1 if created, 0 if about to be deleted
+ */
+void vRtosTraceTask(void * xHandle, int bCreate);
+
+/**
+ * @brief		record a semaphore TAKE request/result or GIVE
+ * @param[in]	pvSema semaphore handle
+ * @param[in]	Type rtosTR_SEM_TAKE or rtosTR_SEM_GIVE
+ * @param[in]	Aux see record types
+ */
+void vRtosTraceSema(void * pvSema, unsigned Type, unsigned Aux);
+
+/**
+ * @brief		allocate the per core rings (first call only) and start recording
+ * @param[in]	Size records per core, rounded up to a power of 2, 0 for rtosTRACE_SIZE
+ * @param[in]	bPSRAM 1 to allocate the rings in PSRAM, else internal RAM
+ * @return		erSUCCESS or erFAILURE if no memory
+ */
+int xRtosTraceStart(unsigned Size, int bPSRAM);
+
+/**
+ * @brief		stop recording, rings are retained for dumping
+ */
+void vRtosTraceStop(void);
+
+struct report_t;
+/**
+ * @brief		report state & record counts of the per core rings
+ * @param[in]	psRprt pointer to report control structure
+ * @return		size of character output generated
+ */
+int xRtosReportTrace(struct report_t * psRprt);
+
+/**
+ * @brief		dump task names & all records, oldest first, as text for tools/rtos_trace2json.py
+ * @param[in]	psRprt pointer to report control structure
+ * @return		size of character output generated
+ * @note		recording is paused during the dump and resumed afterwards
+ */
+int xRtosTraceDump(struct report_t * psRprt);
+
+#ifdef __cplusplus
+}
+#endif
@@ -0,0 +1,247 @@
+//	FreeRTOS_Wheel.c - Copyright (c) 2026 Andre M. MAree / KSS Technologies (Pty) Ltd.
+
+#include "hal_platform.h"
+#include "FreeRTOS_Wheel.h"
+#include "hal_stdio.h"
+#include "errors_events.h"
+#include "utilitiesX.h"
+
+#include "esp_cpu.h"
+#include <string.h>
+
+// ########################################### Macros ##############################################
+
+#define	debugFLAG					0xF000
+#define	debugTIMING					(debugFLAG_GLOBAL & debugFLAG & 0x1000)
+#define	debugTRACK					(debugFLAG_GLOBAL & debugFLAG & 0x2000)
+#define	debugPARAM					(debugFLAG_GLOBAL & debugFLAG & 0x4000)
+#define	debugRESULT					(debugFLAG_GLOBAL & debugFLAG & 0x8000)
+
+// ######################################## Local variables ########################################
+
+/* Level L holds timers expiring between 1 << (BITS * L) and 1 << (BITS * (L+1)) units from now, slot
+ * selected by the matching bits of the expiry time. Each time the lower level wraps the current slot
+ * of the next level up is cascaded down. Timers further away than the wheel range are parked in the
+ * top level and re-evaluated each time they cascade. */
+static struct {
+	rtos_wtmr_t * psSlot[rtosWHEEL_LEVELS][rtosWHEEL_SLOTS];
+	u32_t tNow;											// next unit to be processed
+	TickType_t tRes;									// ticks per unit, 0 = not initialised
+	TickType_t tCount;									// tick hook divider
+	TimerHandle_t thDrv;								// NULL if driven by tick hook
+	u32_t Active, Peak;
+	u32_t Started, Expired, Cascaded, Late;
+	u64_t tExecMax;
+} sWheel = { 0 };
+
+static portMUX_TYPE muxWheel = portMUX_INITIALIZER_UNLOCKED;
+
+// ####################################### Private functions #######################################
+
+static void vRtosWheelLink(rtos_wtmr_t * psT) {
+	u32_t tDelta = psT->tExpire - sWheel.tNow;
+	if ((i32_t) tDelta < 0)
+		tDelta = 0;										// overdue, next unit
+	else if (tDelta > rtosWHEEL_RANGE)
+		tDelta = rtosWHEEL_RANGE;						// park in top level
+	u32_t tExp = sWheel.tNow + tDelta;
+	int L = 0;
+	while (L < (rtosWHEEL_LEVELS - 1) && tDelta >= (1UL << (rtosWHEEL_BITS * (L + 1))))
+		++L;
+	rtos_wtmr_t ** ppsHead = &sWheel.psSlot[L][(tExp >> (rtosWHEEL_BITS * L)) & rtosWHEEL_MASK];
+	psT->psNext = *ppsHead;
+	if (psT->psNext)
+		psT->psNext->ppsPrev = &psT->psNext;
+	*ppsHead = psT;
+	psT->ppsPrev = ppsHead;
+}
+
+static void vRtosWheelUnlink(rtos_wtmr_t * psT) {
+	*psT->ppsPrev = psT->psNext;
+	if (psT->psNext)
+		psT->psNext->ppsPrev = psT->ppsPrev;
+	psT->psNext = NULL;
+	psT->ppsPrev = NULL;
+}
+
+static void vRtosWheelCascade(int L, u32_t Idx) {
+	rtos_wtmr_t * psT = sWheel.psSlot[L][Idx];
+	sWheel.psSlot[L][Idx] = NULL;
+	while (psT) {
+		rtos_wtmr_t * psN = psT->psNext;
+		vRtosWheelLink(psT);
+		++sWheel.Cascaded;
+		psT = psN;
+	}
+}
+
+/**
+ * @brief		process one unit of wheel time, cascade if required then expire timers in current slot
+ * @note		callbacks are executed with the wheel unlocked, the expiring list is held on the stack so
+ * 				callbacks can start/stop/reset any timer, including those still to be processed.
+ */
+static void vRtosWheelAdvance(void) {
+	portENTER_CRITICAL_SAFE(&muxWheel);
+	u32_t tNow = sWheel.tNow;
+	u32_t Idx = tNow & rtosWHEEL_MASK;
+	if (Idx == 0) {
+		for (int L = 1; L < rtosWHEEL_LEVELS; ++L) {
+			u32_t i = (tNow >> (rtosWHEEL_BITS * L)) & rtosWHEEL_MASK;
+			vRtosWheelCascade(L, i);
+			if (i)
+				break;
+		}
+	}
+	rtos_wtmr_t * psWork = sWheel.psSlot[0][Idx];
+	sWheel.psSlot[0][Idx] = NULL;
+	if (psWork)
+		psWork->ppsPrev = &psWork;
+	sWheel.tNow = tNow + 1;								// restarts from callbacks relative to next unit
+	rtos_wtmr_t * psT;
+	while ((psT = psWork) != NULL) {
+		vRtosWheelUnlink(psT);
+		if ((i32_t) (psT->tExpire - tNow) > 0) {		// parked, not yet due
+			vRtosWheelLink(psT);
+			continue;
+		}
+		++psT->Count;
+		++sWheel.Expired;
+		if (psT->tPeriod) {
+			psT->tExpire += psT->tPeriod;
+			if ((i32_t) (psT->tExpire - sWheel.tNow) < 0) {
+				++sWheel.Late;							// callback overran 1 or more periods
+				psT->tExpire = sWheel.tNow;
+			}
+			vRtosWheelLink(psT);
+		} else {
+			--sWheel.Active;
+		}
+		rtos_wtmr_cb_t pfCB = psT->pfCB;
+		portEXIT_CRITICAL_SAFE(&muxWheel);
+		u64_t tStart = rtosRT_NOW();
+		pfCB(psT);										// psT may be freed/reused from here on
+		u64_t tExec = rtosRT_NOW() - tStart;
+		portENTER_CRITICAL_SAFE(&muxWheel);
+		if (tExec > sWheel.tExecMax)
+			sWheel.tExecMax = tExec;
+	}
+	portEXIT_CRITICAL_SAFE(&muxWheel);
+}
+
+static void vRtosWheelTimerCB(TimerHandle_t thTimer) { vRtosWheelAdvance(); }
+
+static u32_t xRtosWheelUnits(TickType_t tTicks) { return (tTicks + sWheel.tRes - 1) / sWheel.tRes; }
+
+static void vRtosWheelStart(rtos_wtmr_t * psT) {
+	if (psT->ppsPrev)
+		vRtosWheelUnlink(psT);
+	else if (++sWheel.Active > sWheel.Peak)
+		sWheel.Peak = sWheel.Active;
+	psT->tExpire = sWheel.tNow + psT->tDelay - 1;		// tDelay of 1 expires on next unit
+	vRtosWheelLink(psT);
+	++sWheel.Started;
+}
+
+// ####################################### Public functions ########################################
+
+int xRtosWheelInit(TickType_t tRes, bool bTickHook) {
+	if (sWheel.tRes)
+		return erSUCCESS;								// already initialised
+	sWheel.tRes = (tRes > 0) ? tRes : 1;
+	if (bTickHook)
+		return erSUCCESS;
+	sWheel.thDrv = xTimerCreate("wheel", sWheel.tRes, pdTRUE, NULL, vRtosWheelTimerCB);
+	if (sWheel.thDrv == NULL || xTimerStart(sWheel.thDrv, 0) != pdPASS) {
+		sWheel.tRes = 0;
+		return erFAILURE;
+	}
+	return erSUCCESS;
+}
+
+void vRtosWheelTickHook(void) {
+	if (sWheel.tRes == 0 || sWheel.thDrv || esp_cpu_get_core_id() != 0)
+		return;											// not initialised, timer driven or other core
+	if (++sWheel.tCount < sWheel.tRes)
+		return;
+	sWheel.tCount = 0;
+	vRtosWheelAdvance();
+}
+
+void vRtosWheelTimerInit(rtos_wtmr_t * psT, const char * pcName, rtos_wtmr_cb_t pfCB, void * pvPara) {
+	IF_myASSERT(debugPARAM, psT && pfCB);
+	memset(psT, 0, sizeof(rtos_wtmr_t));
+	psT->pcName = pcName;
+	psT->pfCB = pfCB;
+	psT->pvPara = pvPara;
+}
+
+void vRtosWheelTimerStart(rtos_wtmr_t * psT, TickType_t tDelay, TickType_t tPeriod) {
+	IF_myASSERT(debugPARAM, psT && psT->pfCB && sWheel.tRes);
+	portENTER_CRITICAL_SAFE(&muxWheel);
+	psT->tDelay = xRtosWheelUnits(tDelay);
+	if (psT->tDelay == 0)
+		psT->tDelay = 1;
+	psT->tPeriod = xRtosWheelUnits(tPeriod);
+	vRtosWheelStart(psT);
+	portEXIT_CRITICAL_SAFE(&muxWheel);
+}
+
+void vRtosWheelTimerReset(rtos_wtmr_t * psT) {
+	IF_myASSERT(debugPARAM, psT && psT->tDelay);
+	portENTER_CRITICAL_SAFE(&muxWheel);
+	vRtosWheelStart(psT);
+	portEXIT_CRITICAL_SAFE(&muxWheel);
+}
+
+void vRtosWheelTimerStop(rtos_wtmr_t * psT) {
+	portENTER_CRITICAL_SAFE(&muxWheel);
+	if (psT->ppsPrev) {
+		vRtosWheelUnlink(psT);
+		--sWheel.Active;
+	}
+	portEXIT_CRITICAL_SAFE(&muxWheel);
+}
+
+bool bRtosWheelTimerActive(rtos_wtmr_t * psT) { return psT->ppsPrev != NULL; }
+
+// ######################################### Reporting #############################################
+
+int xRtosReportWheelTimer(report_t * psR, rtos_wtmr_t * psT) {
+	portENTER_CRITICAL_SAFE(&muxWheel);
+	bool bActive = psT->ppsPrev != NULL;
+	i32_t tRem = (psT->tExpire - sWheel.tNow + 1) * sWheel.tRes;
+	portEXIT_CRITICAL_SAFE(&muxWheel);
+	int iRV = xReport(psR, "%C%s%C\t#%lu  Auto=%c  Run=%c", xpfCOL(colourFG_CYAN,0), psT->pcName ? psT->pcName : "?",
+		xpfCOL(attrRESET,0), psT->Count, psT->tPeriod ? CHR_Y : CHR_N, bActive ? CHR_Y : CHR_N);
+	if (bActive)
+		iRV += xReport(psR, "  tPeriod=%#'lu  tRemain=%#'ld", psT->tPeriod * sWheel.tRes, tRem);
+	if (fmTST(aNL))
+		iRV += xReport(psR, strNL);
+	return iRV;
+}
+
+int xRtosReportWheel(report_t * psR) {
+	u32_t Used[rtosWHEEL_LEVELS] = { 0 }, Count[rtosWHEEL_LEVELS] = { 0 };
+	for (int L = 0; L < rtosWHEEL_LEVELS; ++L) {
+		for (int i = 0; i < rtosWHEEL_SLOTS; ++i) {
+			portENTER_CRITICAL_SAFE(&muxWheel);			// lock per slot, keep latency bounded
+			rtos_wtmr_t * psT = sWheel.psSlot[L][i];
+			if (psT)
+				++Used[L];
+			for (; psT; psT = psT->psNext)
+				++Count[L];
+			portEXIT_CRITICAL_SAFE(&muxWheel);
+		}
+	}
+	int iRV = xReport(psR, "%C%s%C\tRes=%lu  Drv=%s  Now=%lu  Active=%lu  Peak=%lu", xpfCOL(colourFG_CYAN,0), "wheel",
+		xpfCOL(attrRESET,0), sWheel.tRes, sWheel.thDrv ? "timer" : "tick", sWheel.tNow, sWheel.Active, sWheel.Peak);
+	iRV += xReport(psR, "  Start=%lu  Exp=%lu  Casc=%lu  Late=%lu  Emax=%llu", sWheel.Started, sWheel.Expired,
+		sWheel.Cascaded, sWheel.Late, sWheel.tExecMax);
+	if (psR->sFM.bXtras) {
+		for (int L = 0; L < rtosWHEEL_LEVELS; ++L)
+			iRV += xReport(psR, "%s  L%d=%lu/%lu", L ? "" : strNL, L, Count[L], Used[L]);
+	}
+	if (fmTST(aNL))
+		iRV += xReport(psR, strNL);
+	return iRV;
+}
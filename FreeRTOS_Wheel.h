@@ -0,0 +1,115 @@
+// FreeRTOS_Wheel.h
+
+#pragma	once
+
+#include "FreeRTOS_Support.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+// ########################################## Macros ###############################################
+
+#ifndef rtosWHEEL_BITS
+	#define rtosWHEEL_BITS			6					// slots per level = 1 << rtosWHEEL_BITS
+#endif
+#ifndef rtosWHEEL_LEVELS
+	#define rtosWHEEL_LEVELS		4					// range = 1 << (rtosWHEEL_BITS * rtosWHEEL_LEVELS) units
+#endif
+
+#define rtosWHEEL_SLOTS				(1UL << rtosWHEEL_BITS)
+#define rtosWHEEL_MASK				(rtosWHEEL_SLOTS - 1UL)
+#define rtosWHEEL_RANGE				((1UL << (rtosWHEEL_BITS * rtosWHEEL_LEVELS)) - 1UL)
+
+// ######################################## Structures #############################################
+
+/* Hierarchical timer wheel, Varghese & Lauck style with cascading levels, multiplexing any number of
+ * timers onto a single FreeRTOS timer or the tick hook. Nodes are intrusive (embedded in the caller's
+ * own structure) so start/stop/reset are O(1) list operations with no allocation and no timer daemon
+ * command queue traffic. Wheel time is in units of the resolution given to xRtosWheelInit(). */
+struct rtos_wtmr_t;
+typedef void (* rtos_wtmr_cb_t)(struct rtos_wtmr_t *);
+
+typedef struct rtos_wtmr_t {
+	struct rtos_wtmr_t * psNext;
+	struct rtos_wtmr_t ** ppsPrev;						// NULL = not linked in wheel
+	const char * pcName;
+	rtos_wtmr_cb_t pfCB;
+	void * pvPara;										// for use by callback
+	u32_t tExpire;										// wheel units
+	u32_t tDelay;										// wheel units, used by reset
+	u32_t tPeriod;										// wheel units, 0 = one-shot
+	u32_t Count;										// times expired
+} rtos_wtmr_t;
+
+// ################################### Public function prototypes ##################################
+
+/**
+ * @brief		initialise the timer wheel and its driver
+ * @param[in]	tRes resolution of the wheel in ticks (min 1)
+ * @param[in]	bTickHook true if driven by calling vRtosWheelTickHook() from myApplicationTickHook()
+ * @return		erSUCCESS or erFAILURE if the FreeRTOS driver timer could not be created/started
+ * @note		with the tick hook driver callbacks execute in ISR context, else in the timer daemon task
+ */
+int xRtosWheelInit(TickType_t tRes, bool bTickHook);
+
+/**
+ * @brief		advance the wheel, to be called from myApplicationTickHook() if so configured
+ */
+void vRtosWheelTickHook(void);
+
+/**
+ * @brief		initialise a timer node, must be called once before use
+ * @param[in]	psT pointer to timer node
+ * @param[in]	pcName name used in reports
+ * @param[in]	pfCB callback executed on expiry
+ * @param[in]	pvPara optional parameter for use by callback
+ */
+void vRtosWheelTimerInit(rtos_wtmr_t * psT, const char * pcName, rtos_wtmr_cb_t pfCB, void * pvPara);
+
+/**
+ * @brief		(re)start a timer, O(1)
+ * @param[in]	psT pointer to timer node
+ * @param[in]	tDelay ticks until first expiry, rounded up to wheel resolution
+ * @param[in]	tPeriod ticks between subsequent expiries, 0 for one-shot
+ * @note		can be called from the timer callback, also to restart the expiring timer
+ */
+void vRtosWheelTimerStart(rtos_wtmr_t * psT, TickType_t tDelay, TickType_t tPeriod);
+
+/**
+ * @brief		restart a timer with the delay & period of the last start, O(1)
+ * @param[in]	psT pointer to timer node
+ */
+void vRtosWheelTimerReset(rtos_wtmr_t * psT);
+
+/**
+ * @brief		stop a timer, O(1), no effect if not running
+ * @param[in]	psT pointer to timer node
+ */
+void vRtosWheelTimerStop(rtos_wtmr_t * psT);
+
+/**
+ * @brief		check if a timer is running
+ * @param[in]	psT pointer to timer node
+ * @return		true if linked in the wheel
+ */
+bool bRtosWheelTimerActive(rtos_wtmr_t * psT);
+
+/**
+ * @brief		report config & status of a wheel timer
+ * @param[in]	psR pointer to report control structure
+ * @param[in]	psT pointer to timer node
+ * @return		size of character output generated
+ */
+int xRtosReportWheelTimer(struct report_t * psR, rtos_wtmr_t * psT);
+
+/**
+ * @brief		report config, status & per level occupancy of the timer wheel
+ * @param[in]	psR pointer to report control structure
+ * @return		size of character output generated
+ */
+int xRtosReportWheel(struct report_t * psR);
+
+#ifdef __cplusplus
+}
+#endif
@@ -0,0 +1,408 @@
+//	rtos_bench.c - Copyright (c) 2026 Andre M. MAree / KSS Technologies (Pty) Ltd.
+
+/* Host micro-benchmarks for the rtos-support layer, run as a FreeRTOS task on the POSIX port.
+ *
+ *	rtos_bench [-q] [-v] [-b baseline] [-t tolerance]
+ *		-q	quick, 1/10th of the iterations (smoke test)
+ *		-v	print the 64 task report once
+ *		-b	compare against the output of a previous run, exit code 1 if any result is slower
+ *		-t	tolerance for -b in percent, default 25
+ *
+ * Output is one line per benchmark: name, iterations, nSec per operation (best of benchRUNS). The same
+ * names are used by the normal (debug off) and _dbg (rtosSEMA_DEBUG, rtosSEMA_PROFILE & rtosWAKE) builds,
+ * keep a baseline per build. Functional checks print a '#' line and fail the run (exit code 1). Absolute numbers reflect the POSIX port (context switches are thread switches),
+ * only compare results from the same machine. */
+
+#include "hal_platform.h"
+#include "FreeRTOS_Support.h"
+#include "hal_stdio.h"
+#include "errors_events.h"
+
+#include <stdio.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+
+// ########################################### Macros ##############################################
+
+#define benchRUNS					3					// best of, filters scheduling noise
+#define benchPRIO_MAIN				(configMAX_PRIORITIES - 2)	// below the timer task
+#define benchPRIO_WORK				(benchPRIO_MAIN - 1)
+#define benchPRIO_WAKE				(benchPRIO_MAIN + 1)	// handoff receiver preempts the sender
+#define benchPRIO_PARK				(tskIDLE_PRIORITY + 1)
+#define benchTASKS_MAX				64
+#define benchMASK_BATCH				16					// masks held at once, well below rtosTSET_WORDS * 24
+#define benchBASE_MAX				32
+
+// ######################################## Local structures #######################################
+
+typedef u64_t (* bench_fn_t)(u32_t Iter, u32_t Arg);	// returns elapsed nSec for Iter operations
+typedef BaseType_t (* bench_lock_t)(void);				// take or give adapter for contention benchmarks
+
+typedef struct bench_t {
+	const char * pcName;
+	bench_fn_t pfRun;
+	u32_t Iter;
+	u32_t Arg;
+} bench_t;
+
+// ######################################## Local variables ########################################
+
+static TaskHandle_t thBench = NULL;
+static SemaphoreHandle_t shBench = NULL;
+static rtos_amutex_t sAMBench = { 0 };
+static bench_lock_t pfLock, pfUnlock;					// lock under test in vBenchContendTask
+#if (rtosSIGNAL > 0)
+static rtos_signal_t sSigBench;
+#endif
+static SemaphoreHandle_t shBinBench = NULL;
+static char caSink[64 * 1024];
+static report_t sRprt = { .pcBuf = caSink, .Size = sizeof(caSink) };
+static struct { char caName[32]; double dNs; } sBase[benchBASE_MAX];
+static int BaseCount = 0, Tolerance = 25;
+static bool bQuick = false, bVerbose = false;
+
+// ####################################### Private functions #######################################
+
+static u64_t xBenchNow(void) {
+	struct timespec sTS;
+	clock_gettime(CLOCK_MONOTONIC, &sTS);
+	return (u64_t) sTS.tv_sec * 1000000000ULL + sTS.tv_nsec;
+}
+
+static void vBenchParkTask(void * pvPara) {
+	for (;;)
+		vTaskSuspend(NULL);
+}
+
+static BaseType_t xBenchSemaLock(void) { return xRtosSemaphoreTake(&shBench, portMAX_DELAY); }
+static BaseType_t xBenchSemaUnlock(void) { return xRtosSemaphoreGive(&shBench); }
+static BaseType_t xBenchAMutexLock(void) { return xRtosAMutexTake(&sAMBench, portMAX_DELAY); }
+static BaseType_t xBenchAMutexUnlock(void) { return xRtosAMutexGive(&sAMBench); }
+
+static void vBenchContendTask(void * pvPara) {
+	u32_t Iter = (u32_t) (uintptr_t) pvPara;
+	for (u32_t i = 0; i < Iter; ++i) {
+		pfLock();
+		taskYIELD();									// other worker blocks on the held mutex
+		pfUnlock();
+		taskYIELD();									// and takes it before we try again
+	}
+	xTaskNotifyGive(thBench);
+	vTaskSuspend(NULL);
+}
+
+#if (rtosWAKE > 0)
+static void vBenchWakeTask(void * pvPara) {
+	xRtosSemaphoreTake(&shBench, portMAX_DELAY);		// blocks, bench holds the mutex
+	xRtosSemaphoreGive(&shBench);
+	xTaskNotifyGive(thBench);
+	vTaskSuspend(NULL);
+}
+#endif
+
+#if (rtosSIGNAL > 0)
+static void vBenchSignalTask(void * pvPara) {
+	u32_t Iter = (u32_t) (uintptr_t) pvPara;
+	rtos_signal_t * psSig = &sSigBench;
+	vRtosSignalInit(psSig, NULL, 0x01);
+	xTaskNotifyGive(thBench);							// ready, bench can start setting
+	for (u32_t i = 0; i < Iter; ++i)
+		xRtosSignalWait(&psSig, 1, portMAX_DELAY);
+	xTaskNotifyGive(thBench);
+	vTaskSuspend(NULL);
+}
+#endif
+
+static void vBenchBinSemTask(void * pvPara) {
+	u32_t Iter = (u32_t) (uintptr_t) pvPara;
+	xTaskNotifyGive(thBench);
+	for (u32_t i = 0; i < Iter; ++i)
+		xSemaphoreTake(shBinBench, portMAX_DELAY);
+	xTaskNotifyGive(thBench);
+	vTaskSuspend(NULL);
+}
+
+/**
+ * @brief		create parked tasks until the system has the requested number of tasks
+ * @param[out]	pthFill array to receive the handles
+ * @param[in]	Tasks total number of tasks required, including IDLE, timer & bench tasks
+ * @return		number of tasks created
+ */
+static int xBenchFill(TaskHandle_t * pthFill, u32_t Tasks) {
+	int Fill = 0;
+	while (uxTaskGetNumberOfTasks() < Tasks && Fill < benchTASKS_MAX) {
+		char caName[configMAX_TASK_NAME_LEN];
+		snprintf(caName, sizeof(caName), "fill%02d", Fill);
+		if (xTaskCreate(vBenchParkTask, caName, configMINIMAL_STACK_SIZE, NULL, benchPRIO_PARK, &pthFill[Fill]) != pdPASS)
+			break;
+		++Fill;
+	}
+	vTaskDelay(2);										// let them run once & park
+	return Fill;
+}
+
+// ######################################### Benchmarks ############################################
+
+static u64_t xBenchSemaRaw(u32_t Iter, u32_t Arg) {
+	SemaphoreHandle_t shRaw = xSemaphoreCreateMutex();
+	u64_t tStart = xBenchNow();
+	for (u32_t i = 0; i < Iter; ++i) {
+		xSemaphoreTake(shRaw, portMAX_DELAY);
+		xSemaphoreGive(shRaw);
+	}
+	u64_t tElap = xBenchNow() - tStart;
+	vSemaphoreDelete(shRaw);
+	return tElap;
+}
+
+static u64_t xBenchSemaTake(u32_t Iter, u32_t Arg) {
+	u64_t tStart = xBenchNow();
+	for (u32_t i = 0; i < Iter; ++i) {
+		xRtosSemaphoreTake(&shBench, portMAX_DELAY);
+		xRtosSemaphoreGive(&shBench);
+	}
+	return xBenchNow() - tStart;
+}
+
+static u64_t xBenchAMutexTake(u32_t Iter, u32_t Arg) {
+	u64_t tStart = xBenchNow();
+	for (u32_t i = 0; i < Iter; ++i) {
+		xRtosAMutexTake(&sAMBench, portMAX_DELAY);
+		xRtosAMutexGive(&sAMBench);
+	}
+	return xBenchNow() - tStart;
+}
+
+/**
+ * @brief		run Workers tasks alternately taking & giving the lock under test
+ * @note		single core port, xRtosAMutexTake() never spins and measures the blocking fallback
+ */
+static u64_t xBenchContend(u32_t Iter, u32_t Workers, bench_lock_t pfL, bench_lock_t pfU) {
+	TaskHandle_t thWork[benchTASKS_MAX];
+	pfLock = pfL;
+	pfUnlock = pfU;
+	for (u32_t w = 0; w < Workers; ++w)
+		xTaskCreate(vBenchContendTask, "work", configMINIMAL_STACK_SIZE, (void *) (uintptr_t) (Iter / Workers), benchPRIO_WORK, &thWork[w]);
+	u64_t tStart = xBenchNow();
+	for (u32_t w = 0; w < Workers; ++w)					// workers run while we wait
+		ulTaskNotifyTake(pdFALSE, portMAX_DELAY);
+	u64_t tElap = xBenchNow() - tStart;
+	for (u32_t w = 0; w < Workers; ++w)
+		vTaskDelete(thWork[w]);
+	return tElap;
+}
+
+static u64_t xBenchSemaContend(u32_t Iter, u32_t Workers) {
+	return xBenchContend(Iter, Workers, xBenchSemaLock, xBenchSemaUnlock);
+}
+
+static u64_t xBenchAMutexContend(u32_t Iter, u32_t Workers) {
+	return xBenchContend(Iter, Workers, xBenchAMutexLock, xBenchAMutexUnlock);
+}
+
+/* Handoff: each SET/GIVE readies the higher priority receiver which runs, consumes the event and blocks
+ * again before the sender continues, so one iteration is a complete wake & switch round trip. The
+ * POSIX port has no ISRs, the FromISR paths (vs xSemaphoreGiveFromISR()) are not measured here. */
+#if (rtosSIGNAL > 0)
+static u64_t xBenchSignal(u32_t Iter, u32_t Arg) {
+	TaskHandle_t thWake;
+	xTaskCreate(vBenchSignalTask, "sig", configMINIMAL_STACK_SIZE, (void *) (uintptr_t) Iter, benchPRIO_WAKE, &thWake);
+	ulTaskNotifyTake(pdTRUE, portMAX_DELAY);
+	u64_t tStart = xBenchNow();
+	for (u32_t i = 0; i < Iter; ++i)
+		xRtosSignalSet(&sSigBench, 1);
+	u64_t tElap = xBenchNow() - tStart;
+	ulTaskNotifyTake(pdTRUE, portMAX_DELAY);
+	vTaskDelete(thWake);
+	return tElap;
+}
+#endif
+
+static u64_t xBenchBinSem(u32_t Iter, u32_t Arg) {
+	TaskHandle_t thWake;
+	shBinBench = xSemaphoreCreateBinary();
+	xTaskCreate(vBenchBinSemTask, "bin", configMINIMAL_STACK_SIZE, (void *) (uintptr_t) Iter, benchPRIO_WAKE, &thWake);
+	ulTaskNotifyTake(pdTRUE, portMAX_DELAY);
+	u64_t tStart = xBenchNow();
+	for (u32_t i = 0; i < Iter; ++i)
+		xSemaphoreGive(shBinBench);
+	u64_t tElap = xBenchNow() - tStart;
+	ulTaskNotifyTake(pdTRUE, portMAX_DELAY);
+	vTaskDelete(thWake);
+	vSemaphoreDelete(shBinBench);
+	return tElap;
+}
+
+static u64_t xBenchTaskCreate(u32_t Iter, u32_t Arg) {
+	u64_t tStart = xBenchNow();
+	for (u32_t i = 0; i < Iter; ++i) {
+		TaskHandle_t thPark = NULL;
+		xTaskCreate(vBenchParkTask, "park", configMINIMAL_STACK_SIZE, NULL, benchPRIO_PARK, &thPark);
+		vTaskDelete(thPark);
+	}
+	return xBenchNow() - tStart;
+}
+
+static u64_t xBenchReport(u32_t Iter, u32_t Tasks) {
+	TaskHandle_t thFill[benchTASKS_MAX];
+	int Fill = xBenchFill(thFill, Tasks);
+	u64_t tStart = xBenchNow();
+	for (u32_t i = 0; i < Iter; ++i) {
+		sRprt.Used = 0;
+		xRtosReportTasks(&sRprt);
+	}
+	u64_t tElap = xBenchNow() - tStart;
+	while (Fill > 0)
+		vTaskDelete(thFill[--Fill]);
+	return tElap;
+}
+
+static u64_t xBenchMask(u32_t Iter, u32_t Arg) {
+	u32_t Mask[benchMASK_BATCH];
+	u64_t tStart = xBenchNow();
+	for (u32_t i = 0; i < Iter; i += benchMASK_BATCH) {
+		for (int b = 0; b < benchMASK_BATCH; ++b)
+			Mask[b] = xRtosTaskMaskAlloc();
+		for (int b = 0; b < benchMASK_BATCH; ++b)
+			vRtosTaskMaskFree(Mask[b]);
+	}
+	return xBenchNow() - tStart;
+}
+
+static const bench_t sBench[] = {
+	{ "sema_raw",				xBenchSemaRaw,		200000,	0 },	// kernel only, reference
+	{ "sema_uncontended",		xBenchSemaTake,		200000,	0 },
+	{ "sema_contended",			xBenchSemaContend,	4000,	2 },
+	{ "amutex_uncontended",		xBenchAMutexTake,	200000,	0 },
+	{ "amutex_contended",		xBenchAMutexContend,4000,	2 },
+	#if (rtosSIGNAL > 0)
+	{ "signal_handoff",			xBenchSignal,		100000,	0 },
+	#endif
+	{ "binsem_handoff",			xBenchBinSem,		100000,	0 },	// same handoff via binary semaphore
+	{ "task_create_delete",		xBenchTaskCreate,	400,	0 },
+	{ "report_tasks_8",			xBenchReport,		400,	8 },
+	{ "report_tasks_24",		xBenchReport,		200,	24 },
+	{ "report_tasks_64",		xBenchReport,		100,	64 },
+	{ "mask_alloc_free",		xBenchMask,			160000,	0 },
+};
+
+// ###################################### Functional checks ########################################
+
+#if (rtosWAKE > 0)
+/**
+ * @brief		a give handing the mutex to a blocked waiter must produce exactly one primitive record
+ * @return		1 if failed, else 0
+ */
+static int xBenchWakeCheck(void) {
+	TaskHandle_t thWake;
+	xRtosSemaphoreTake(&shBench, portMAX_DELAY);
+	xTaskCreate(vBenchWakeTask, "wake", configMINIMAL_STACK_SIZE, NULL, benchPRIO_WAKE, &thWake);
+	xRtosSemaphoreGive(&shBench);						// stamps the waiter, which preempts
+	ulTaskNotifyTake(pdTRUE, portMAX_DELAY);
+	vTaskDelete(thWake);
+	char caKey[24];
+	snprintf(caKey, sizeof(caKey), "%p", (void *) shBench);
+	sRprt.Used = 0;
+	xRtosReportWake(&sRprt);
+	int Recs = 0;
+	for (const char * pc = caSink; (pc = strstr(pc, caKey)) != NULL; pc += strlen(caKey))
+		++Recs;
+	printf("# wake_check %d primitive record(s)%s\n", Recs, (Recs == 1) ? "" : "  FAIL, expected 1");
+	return Recs != 1;
+}
+#endif
+
+// ######################################### Baseline ##############################################
+
+static void vBenchBaseLoad(const char * pcFile) {
+	FILE * psF = fopen(pcFile, "r");
+	if (psF == NULL) {
+		perror(pcFile);
+		exit(2);
+	}
+	char caLine[128];
+	while (BaseCount < benchBASE_MAX && fgets(caLine, sizeof(caLine), psF)) {
+		unsigned long Iter;
+		if (caLine[0] != '#' && sscanf(caLine, "%31s %lu %lf", sBase[BaseCount].caName, &Iter, &sBase[BaseCount].dNs) == 3)
+			++BaseCount;
+	}
+	fclose(psF);
+}
+
+/**
+ * @brief		compare a result with the baseline and report the difference
+ * @return		1 if slower than the baseline plus tolerance, else 0
+ */
+static int xBenchBaseCheck(const char * pcName, double dNs) {
+	for (int i = 0; i < BaseCount; ++i) {
+		if (strcmp(sBase[i].caName, pcName) || sBase[i].dNs <= 0.0)
+			continue;
+		double dPct = (dNs - sBase[i].dNs) * 100.0 / sBase[i].dNs;
+		bool bSlow = dPct > Tolerance;
+		printf("  base %.1f  %+.1f%%%s", sBase[i].dNs, dPct, bSlow ? "  REGRESSION" : "");
+		return bSlow;
+	}
+	return 0;
+}
+
+// ######################################### Bench task ############################################
+
+static void vBenchTask(void * pvPara) {
+	sRprt.sFM = (fm_t) { .uCount = 0xFFFFFF, .bTskNum = 1, .bPrioX = 1, .bState = 1, .bStack = 1, .bCore = 1, .bNL = 1 };
+	xRtosSemaphoreInit(&shBench);
+	printf("# rtos_bench  SEMA_DEBUG=%d  SEMA_PROFILE=%d  WAKE=%d  Tick=%dHz%s\n", rtosSEMA_DEBUG, rtosSEMA_PROFILE, rtosWAKE,
+		configTICK_RATE_HZ, bQuick ? "  quick" : "");
+	int Slow = 0, Fail = 0;
+#if (rtosWAKE > 0)
+	Fail += xBenchWakeCheck();
+#endif
+	for (int b = 0; b < NO_MEM(sBench); ++b) {
+		const bench_t * psB = &sBench[b];
+		u32_t Iter = bQuick ? (psB->Iter / 10) : psB->Iter;
+		u64_t tBest = UINT64_MAX;
+		for (int r = 0; r < benchRUNS; ++r) {
+			u64_t tElap = psB->pfRun(Iter, psB->Arg);
+			if (tElap < tBest)
+				tBest = tElap;
+		}
+		double dNs = (double) tBest / Iter;
+		printf("%-20s %8lu %10.1f", psB->pcName, (unsigned long) Iter, dNs);
+		Slow += xBenchBaseCheck(psB->pcName, dNs);
+		printf("\n");
+	}
+	if (bVerbose) {
+		TaskHandle_t thFill[benchTASKS_MAX];
+		int Fill = xBenchFill(thFill, benchTASKS_MAX);
+		sRprt.Used = 0;
+		xRtosReportTasks(&sRprt);
+		printf("%s", caSink);
+		while (Fill > 0)
+			vTaskDelete(thFill[--Fill]);
+	}
+	if (Slow)
+		printf("# %d result(s) more than %d%% slower than baseline\n", Slow, Tolerance);
+	if (Fail)
+		printf("# %d functional check(s) failed\n", Fail);
+	fflush(stdout);
+	exit((Slow || Fail) ? 1 : 0);
+}
+
+int main(int argc, char * argv[]) {
+	int Opt;
+	while ((Opt = getopt(argc, argv, "qvb:t:")) != -1) {
+		switch (Opt) {
+		case 'q':	bQuick = true;					break;
+		case 'v':	bVerbose = true;				break;
+		case 'b':	vBenchBaseLoad(optarg);			break;
+		case 't':	Tolerance = atoi(optarg);		break;
+		default:
+			fprintf(stderr, "usage: %s [-q] [-v] [-b baseline] [-t tolerance%%]\n", argv[0]);
+			return 2;
+		}
+	}
+	vHostEventInit();
+	xTaskCreate(vBenchTask, "bench", configMINIMAL_STACK_SIZE * 2, NULL, benchPRIO_MAIN, &thBench);
+	vTaskStartScheduler();
+	return 2;											// only if the scheduler could not start
+}
@@ -0,0 +1,85 @@
+// FreeRTOSConfig.h - host (Linux) build, FreeRTOS POSIX port
+
+#pragma	once
+
+/* Mirrors the ESP-IDF configuration the rtos-support layer is normally built with where the POSIX port
+ * allows it: 25 priorities, 1kHz tick, 16 char names, 64 bit runtime counter in uSec, trace facility
+ * (task & queue numbers) and thread local storage for the task mask & arena pointers. */
+
+#ifndef __ASSEMBLER__
+	unsigned long long ullHostRunTimeCounter(void);
+#endif
+
+// ########################################## Scheduler ############################################
+
+#define configUSE_PREEMPTION					1
+#define configUSE_PORT_OPTIMISED_TASK_SELECTION	0
+#define configUSE_TIME_SLICING					1
+#define configTICK_RATE_HZ						1000
+#define configTICK_TYPE_WIDTH_IN_BITS			TICK_TYPE_WIDTH_32_BITS
+#define configMAX_PRIORITIES					25
+#define configMINIMAL_STACK_SIZE				4096		// words, >= PTHREAD_STACK_MIN
+#define configSTACK_DEPTH_TYPE					uint32_t
+#define configMAX_TASK_NAME_LEN					16
+#define configNUM_THREAD_LOCAL_STORAGE_POINTERS	4
+#define configTASK_NOTIFICATION_ARRAY_ENTRIES	3
+#define configUSE_TASK_NOTIFICATIONS			1
+#define configIDLE_SHOULD_YIELD					1
+
+// ########################################## Memory ###############################################
+
+#define configSUPPORT_STATIC_ALLOCATION			1
+#define configSUPPORT_DYNAMIC_ALLOCATION		1
+#define configKERNEL_PROVIDED_STATIC_MEMORY		1
+#define configTOTAL_HEAP_SIZE					(64 * 1024 * 1024)	// unused with heap_3 (malloc)
+#define configAPPLICATION_ALLOCATED_HEAP		0
+
+// ######################################## Primitives #############################################
+
+#define configUSE_MUTEXES						1
+#define configUSE_RECURSIVE_MUTEXES				1
+#define configUSE_COUNTING_SEMAPHORES			1
+#define configUSE_QUEUE_SETS					0
+#define configQUEUE_REGISTRY_SIZE				0
+#define configUSE_EVENT_GROUPS					1
+#define configUSE_TIMERS						1
+#define configTIMER_TASK_PRIORITY				(configMAX_PRIORITIES - 1)
+#define configTIMER_QUEUE_LENGTH				32
+#define configTIMER_TASK_STACK_DEPTH			configMINIMAL_STACK_SIZE
+
+// ####################################### Hooks & stats ###########################################
+
+#define configUSE_IDLE_HOOK						1			// esp_register_freertos_idle_hook_for_cpu()
+#define configUSE_TICK_HOOK						1			// esp_register_freertos_tick_hook_for_cpu()
+#define configUSE_MALLOC_FAILED_HOOK			0
+#define configCHECK_FOR_STACK_OVERFLOW			0
+#define configUSE_TRACE_FACILITY				1
+#define configUSE_STATS_FORMATTING_FUNCTIONS	0
+#define configRECORD_STACK_HIGH_ADDRESS			1
+#define configGENERATE_RUN_TIME_STATS			1
+#define configRUN_TIME_COUNTER_TYPE				uint64_t
+#define portCONFIGURE_TIMER_FOR_RUN_TIME_STATS()
+#define portGET_RUN_TIME_COUNTER_VALUE()		ullHostRunTimeCounter()
+
+#define configASSERT(x)							do { if ((x) == 0) vAssertCalled(__FILE__, __LINE__); } while (0)
+#ifndef __ASSEMBLER__
+	void vAssertCalled(const char * pcFile, unsigned long ulLine);
+#endif
+
+// ######################################## API inclusion ##########################################
+
+#define INCLUDE_vTaskPrioritySet				1
+#define INCLUDE_uxTaskPriorityGet				1
+#define INCLUDE_vTaskDelete						1
+#define INCLUDE_vTaskSuspend					1
+#define INCLUDE_xTaskDelayUntil					1
+#define INCLUDE_vTaskDelay						1
+#define INCLUDE_xTaskGetSchedulerState			1
+#define INCLUDE_xTaskGetCurrentTaskHandle		1
+#define INCLUDE_uxTaskGetStackHighWaterMark		1
+#define INCLUDE_xTaskGetIdleTaskHandle			1
+#define INCLUDE_eTaskGetState					1
+#define INCLUDE_xTaskGetHandle					1
+#define INCLUDE_xTimerPendFunctionCall			1
+#define INCLUDE_xSemaphoreGetMutexHolder		1
+#define INCLUDE_xEventGroupSetBitFromISR		1
@@ -0,0 +1,46 @@
+// definitions.h - host build stub, subset of the common definitions used by rtos-support
+
+#pragma	once
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <stdlib.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+// ########################################## Macros ###############################################
+
+#ifndef debugFLAG_GLOBAL
+	#define debugFLAG_GLOBAL		0x0000				// -DdebugFLAG_GLOBAL=0xC000 enables PARAM & RESULT asserts
+#endif
+
+#define NO_MEM(a)					(sizeof(a) / sizeof(a[0]))
+#define INRANGE(l,v,h)				(((l) <= (v)) && ((v) <= (h)))
+
+#define CHR_Y						'Y'
+#define CHR_N						'N'
+#define strNL						"\r\n"
+#define strNLx2						"\r\n\n"
+
+// ######################################### Structures ############################################
+
+typedef uint8_t		u8_t;
+typedef uint16_t	u16_t;
+typedef uint32_t	u32_t;
+typedef uint64_t	u64_t;
+typedef int8_t		i8_t;
+typedef int16_t		i16_t;
+typedef int32_t		i32_t;
+typedef int64_t		i64_t;
+
+typedef union u64rt_t {
+	u64_t U64val;
+	u32_t U32val[2];
+} u64rt_t;
+
+#ifdef __cplusplus
+}
+#endif
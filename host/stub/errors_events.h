@@ -0,0 +1,21 @@
+// errors_events.h - host build stub
+
+#pragma	once
+
+#include "FreeRTOS_Support.h"
+
+#define erSUCCESS					0
+#define erFAILURE					(-1)
+#define erINV_PARA					(-2)
+#define erINV_STATE					(-3)
+#define erNO_MEM					(-4)
+
+extern EventGroupHandle_t TaskRunState, TaskDeleteState;	// task set word 0 RUN & DELETE flags
+
+/**
+ * @brief		create the hal event groups, done by the hal during startup on target
+ */
+void vHostEventInit(void);
+
+void halEventUpdateRunTasks(EventBits_t ebX, bool bSet);
+void halEventUpdateDeleteTasks(EventBits_t ebX, bool bSet);
@@ -0,0 +1,9 @@
+// esp_attr.h - host build stub, no placement attributes
+
+#pragma	once
+
+#define IRAM_ATTR
+#define DRAM_ATTR
+#define __NOINIT_ATTR
+#define RTC_NOINIT_ATTR
+#define EXT_RAM_BSS_ATTR
@@ -0,0 +1,16 @@
+// esp_cpu.h - host build stub, single core, cycle count from the monotonic clock (nSec)
+
+#pragma	once
+
+#include <stdint.h>
+#include <time.h>
+
+static inline int esp_cpu_get_core_id(void) { return 0; }
+
+static inline void * esp_cpu_get_sp(void) { return __builtin_frame_address(0); }
+
+static inline uint32_t esp_cpu_get_cycle_count(void) {
+	struct timespec sTS;
+	clock_gettime(CLOCK_MONOTONIC, &sTS);
+	return (uint32_t) ((uint64_t) sTS.tv_sec * 1000000000ULL + sTS.tv_nsec);
+}
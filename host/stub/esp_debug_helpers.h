@@ -0,0 +1,7 @@
+// esp_debug_helpers.h - host build stub
+
+#pragma	once
+
+#include "esp_err.h"
+
+static inline esp_err_t esp_backtrace_print(int Depth) { (void) Depth; return ESP_OK; }
@@ -0,0 +1,9 @@
+// esp_err.h - host build stub
+
+#pragma	once
+
+typedef int esp_err_t;
+
+#define ESP_OK						0
+#define ESP_FAIL					(-1)
+#define ESP_ERR_NO_MEM				0x101
@@ -0,0 +1,14 @@
+// esp_freertos_hooks.h - host build stub, hooks called from vApplicationTickHook/IdleHook in esp_host.c
+
+#pragma	once
+
+#include "esp_err.h"
+#include <stdbool.h>
+
+typedef void (* esp_freertos_tick_cb_t)(void);
+typedef bool (* esp_freertos_idle_cb_t)(void);
+
+esp_err_t esp_register_freertos_tick_hook_for_cpu(esp_freertos_tick_cb_t pfCB, int Cpu);
+void esp_deregister_freertos_tick_hook_for_cpu(esp_freertos_tick_cb_t pfCB, int Cpu);
+esp_err_t esp_register_freertos_idle_hook_for_cpu(esp_freertos_idle_cb_t pfCB, int Cpu);
+void esp_deregister_freertos_idle_hook_for_cpu(esp_freertos_idle_cb_t pfCB, int Cpu);
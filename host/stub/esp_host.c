@@ -0,0 +1,163 @@
+//	esp_host.c - host build, ESP-IDF & FreeRTOS application hooks on top of the POSIX port
+
+#include "hal_platform.h"
+#include "FreeRTOS_Support.h"
+#include "hal_stdio.h"
+
+#include "esp_freertos_hooks.h"
+#include "esp_heap_caps.h"
+#include "freertos/task_snapshot.h"
+#include <malloc.h>
+#include <stdio.h>
+#include <time.h>
+
+// ########################################### Macros ##############################################
+
+#define hostHOOKS_MAX				8
+
+// ######################################## Local variables ########################################
+
+static esp_freertos_tick_cb_t pfTickHook[hostHOOKS_MAX] = { 0 };
+static esp_freertos_idle_cb_t pfIdleHook[hostHOOKS_MAX] = { 0 };
+static u64_t tHostStart = 0;
+
+// ####################################### FreeRTOS hooks ##########################################
+
+unsigned long long ullHostRunTimeCounter(void) {
+	struct timespec sTS;
+	clock_gettime(CLOCK_MONOTONIC, &sTS);
+	u64_t tNow = (u64_t) sTS.tv_sec * 1000000ULL + sTS.tv_nsec / 1000;
+	if (tHostStart == 0)
+		tHostStart = tNow - 1;
+	return tNow - tHostStart;							// uSec, same unit as esp_timer on target
+}
+
+void vAssertCalled(const char * pcFile, unsigned long ulLine) {
+	fprintf(stderr, "configASSERT %s:%lu\n", pcFile, ulLine);
+	abort();
+}
+
+void vApplicationTickHook(void) {
+	for (int i = 0; i < hostHOOKS_MAX; ++i) {
+		esp_freertos_tick_cb_t pfCB = __atomic_load_n(&pfTickHook[i], __ATOMIC_ACQUIRE);
+		if (pfCB)
+			pfCB();
+	}
+}
+
+void vApplicationIdleHook(void) {
+	for (int i = 0; i < hostHOOKS_MAX; ++i) {
+		esp_freertos_idle_cb_t pfCB = __atomic_load_n(&pfIdleHook[i], __ATOMIC_ACQUIRE);
+		if (pfCB)
+			pfCB();
+	}
+}
+
+// ######################################## ESP-IDF hooks ##########################################
+
+static esp_err_t xHostHookAdd(void ** ppvTable, void * pvCB, int Cpu) {
+	if (Cpu != 0)
+		return ESP_FAIL;
+	for (int i = 0; i < hostHOOKS_MAX; ++i) {
+		void * pvFree = NULL;
+		if (__atomic_compare_exchange_n(&ppvTable[i], &pvFree, pvCB, 0, __ATOMIC_ACQ_REL, __ATOMIC_RELAXED))
+			return ESP_OK;
+	}
+	return ESP_ERR_NO_MEM;
+}
+
+static void vHostHookDel(void ** ppvTable, void * pvCB) {
+	for (int i = 0; i < hostHOOKS_MAX; ++i) {
+		void * pvOld = pvCB;
+		__atomic_compare_exchange_n(&ppvTable[i], &pvOld, NULL, 0, __ATOMIC_ACQ_REL, __ATOMIC_RELAXED);
+	}
+}
+
+esp_err_t esp_register_freertos_tick_hook_for_cpu(esp_freertos_tick_cb_t pfCB, int Cpu) {
+	return xHostHookAdd((void **) pfTickHook, (void *) pfCB, Cpu);
+}
+
+void esp_deregister_freertos_tick_hook_for_cpu(esp_freertos_tick_cb_t pfCB, int Cpu) {
+	vHostHookDel((void **) pfTickHook, (void *) pfCB);
+}
+
+esp_err_t esp_register_freertos_idle_hook_for_cpu(esp_freertos_idle_cb_t pfCB, int Cpu) {
+	return xHostHookAdd((void **) pfIdleHook, (void *) pfCB, Cpu);
+}
+
+void esp_deregister_freertos_idle_hook_for_cpu(esp_freertos_idle_cb_t pfCB, int Cpu) {
+	vHostHookDel((void **) pfIdleHook, (void *) pfCB);
+}
+
+// ################################# ESP-IDF FreeRTOS extensions ###################################
+
+BaseType_t xTaskCreatePinnedToCore(TaskFunction_t pxTaskCode, const char * const pcName, const uint32_t usStackDepth,
+	void * const pvParameters, UBaseType_t uxPriority, TaskHandle_t * const pxCreatedTask, const BaseType_t xCoreID) {
+	return __real_xTaskCreate(pxTaskCode, pcName, usStackDepth, pvParameters, uxPriority, pxCreatedTask);
+}
+
+TaskHandle_t xTaskCreateStaticPinnedToCore(TaskFunction_t pxTaskCode, const char * const pcName, const uint32_t ulStackDepth,
+	void * const pvParameters, UBaseType_t uxPriority, StackType_t * const pxStackBuffer, StaticTask_t * const pxTaskBuffer,
+	const BaseType_t xCoreID) {
+	return __real_xTaskCreateStatic(pxTaskCode, pcName, ulStackDepth, pvParameters, uxPriority, pxStackBuffer, pxTaskBuffer);
+}
+
+uint8_t * pxHostTaskGetStackStart(TaskHandle_t xHandle) {
+	TaskStatus_t sTS;
+	vTaskGetInfo(xHandle, &sTS, pdFALSE, eInvalid);
+	return (uint8_t *) sTS.pxStackBase;
+}
+
+/* upstream has no list-only walk, build the list from uxTaskGetSystemState(), cost is irrelevant here */
+UBaseType_t uxTaskGetSnapshotAll(TaskSnapshot_t * const pxTaskSnapshotArray, const UBaseType_t uxArrayLength,
+	UBaseType_t * const pxTCBSize) {
+	UBaseType_t Num = uxTaskGetNumberOfTasks();
+	TaskStatus_t * psTS = malloc(Num * sizeof(TaskStatus_t));
+	if (psTS == NULL)
+		return 0;
+	Num = uxTaskGetSystemState(psTS, Num, NULL);
+	if (Num > uxArrayLength)
+		Num = uxArrayLength;
+	for (UBaseType_t t = 0; t < Num; ++t) {
+		pxTaskSnapshotArray[t].pxTCB = psTS[t].xHandle;
+		pxTaskSnapshotArray[t].pxTopOfStack = NULL;
+		pxTaskSnapshotArray[t].pxEndOfStack = psTS[t].pxStackBase;
+	}
+	free(psTS);
+	*pxTCBSize = 0;
+	return Num;
+}
+
+// ########################################### Heap ################################################
+
+/* heap_3 (C library malloc) does not track free space, report what the C library knows */
+size_t xPortGetFreeHeapSize(void) {
+	struct mallinfo2 sMI = mallinfo2();
+	return sMI.fordblks;
+}
+
+size_t xPortGetMinimumEverFreeHeapSize(void) { return xPortGetFreeHeapSize(); }
+
+void * heap_caps_malloc(size_t Size, uint32_t Caps) { return malloc(Size); }
+
+void heap_caps_free(void * pvMem) { free(pvMem); }
+
+size_t heap_caps_get_total_size(uint32_t Caps) {
+	struct mallinfo2 sMI = mallinfo2();
+	return sMI.arena + sMI.hblkhd;
+}
+
+size_t heap_caps_get_allocated_size(void * pvMem) { return malloc_usable_size(pvMem); }
+
+void heap_caps_get_info(multi_heap_info_t * psInfo, uint32_t Caps) {
+	struct mallinfo2 sMI = mallinfo2();
+	*psInfo = (multi_heap_info_t) {
+		.total_free_bytes = sMI.fordblks,
+		.total_allocated_bytes = sMI.uordblks + sMI.hblkhd,
+		.largest_free_block = sMI.fordblks,
+		.minimum_free_bytes = sMI.fordblks,
+		.allocated_blocks = sMI.hblks,
+		.free_blocks = sMI.ordblks,
+		.total_blocks = sMI.hblks + sMI.ordblks,
+	};
+}
@@ -0,0 +1,39 @@
+// freertos/FreeRTOS.h - host build, upstream kernel plus the ESP-IDF extensions used by rtos-support
+
+#pragma	once
+
+#include <FreeRTOS.h>									// upstream kernel, not this file
+#include "esp_cpu.h"									// included via portmacro.h on ESP-IDF
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+// ########################################## Macros ###############################################
+
+#define portNUM_PROCESSORS			1
+#define tskNO_AFFINITY				((BaseType_t) 0x7FFFFFFF)
+
+#define CONFIG_FREERTOS_MAX_TASK_NAME_LEN			configMAX_TASK_NAME_LEN
+#define CONFIG_FREERTOS_RUN_TIME_COUNTER_TYPE_U64	1
+
+/* The POSIX port has a single (simulated) core and no interrupt context, the spinlock argument of the
+ * ESP-IDF critical section macros is ignored and all variants map to the nesting task critical section */
+typedef struct { uint32_t Count; } portMUX_TYPE;
+#define portMUX_INITIALIZER_UNLOCKED	{ 0 }
+
+#undef	portENTER_CRITICAL
+#undef	portEXIT_CRITICAL
+#define portENTER_CRITICAL(pMux)		do { (void) (pMux); vPortEnterCritical(); } while (0)
+#define portEXIT_CRITICAL(pMux)			do { (void) (pMux); vPortExitCritical(); } while (0)
+#define portENTER_CRITICAL_ISR(pMux)	portENTER_CRITICAL(pMux)
+#define portEXIT_CRITICAL_ISR(pMux)		portEXIT_CRITICAL(pMux)
+#define portENTER_CRITICAL_SAFE(pMux)	portENTER_CRITICAL(pMux)
+#define portEXIT_CRITICAL_SAFE(pMux)	portEXIT_CRITICAL(pMux)
+
+#undef	portYIELD_FROM_ISR
+#define portYIELD_FROM_ISR(...)			do { } while (0)	// never in ISR context on the host
+
+#ifdef __cplusplus
+}
+#endif
@@ -0,0 +1,6 @@
+// freertos/event_groups.h - host build, upstream kernel header
+
+#pragma	once
+
+#include "freertos/task.h"
+#include <event_groups.h>
@@ -0,0 +1,6 @@
+// freertos/queue.h - host build, upstream kernel header
+
+#pragma	once
+
+#include "freertos/task.h"
+#include <queue.h>
@@ -0,0 +1,6 @@
+// freertos/semphr.h - host build, upstream kernel header
+
+#pragma	once
+
+#include "freertos/task.h"
+#include <semphr.h>
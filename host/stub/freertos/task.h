@@ -0,0 +1,48 @@
+// freertos/task.h - host build, upstream kernel plus the ESP-IDF extensions used by rtos-support
+
+#pragma	once
+
+#include "freertos/FreeRTOS.h"
+#include <task.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+// ########################################## Macros ###############################################
+
+#undef	taskENTER_CRITICAL
+#undef	taskEXIT_CRITICAL
+#define taskENTER_CRITICAL(pMux)		portENTER_CRITICAL(pMux)
+#define taskEXIT_CRITICAL(pMux)			portEXIT_CRITICAL(pMux)
+#define taskENTER_CRITICAL_ISR(pMux)	portENTER_CRITICAL(pMux)
+#define taskEXIT_CRITICAL_ISR(pMux)		portEXIT_CRITICAL(pMux)
+
+#define xTaskGetCurrentTaskHandleForCore(c)	xTaskGetCurrentTaskHandle()
+#define xTaskGetIdleTaskHandleForCore(c)	xTaskGetIdleTaskHandle()
+#define xTaskGetCoreID(xHandle)				((void) (xHandle), (BaseType_t) 0)
+#define rtosTS_CORE(psTS)					((void) (psTS), 0)	// TaskStatus_t has no xCoreID upstream
+#define pxTaskGetStackStart(xHandle)		pxHostTaskGetStackStart(xHandle)
+
+// ################################### Public function prototypes ##################################
+
+/**
+ * @brief		ESP-IDF pinned create variants, core ID ignored, provided by esp_host.c so that the
+ * 				--wrap'ed create functions in FreeRTOS_Support.c have a __real_ counterpart
+ */
+BaseType_t xTaskCreatePinnedToCore(TaskFunction_t pxTaskCode, const char * const pcName, const uint32_t usStackDepth,
+	void * const pvParameters, UBaseType_t uxPriority, TaskHandle_t * const pxCreatedTask, const BaseType_t xCoreID);
+TaskHandle_t xTaskCreateStaticPinnedToCore(TaskFunction_t pxTaskCode, const char * const pcName, const uint32_t ulStackDepth,
+	void * const pvParameters, UBaseType_t uxPriority, StackType_t * const pxStackBuffer, StaticTask_t * const pxTaskBuffer,
+	const BaseType_t xCoreID);
+
+/**
+ * @brief		lowest address of a task's stack, as returned by the ESP-IDF API
+ * @param[in]	xHandle task handle, NULL for current task
+ * @return		pointer to start of stack
+ */
+uint8_t * pxHostTaskGetStackStart(TaskHandle_t xHandle);
+
+#ifdef __cplusplus
+}
+#endif
@@ -0,0 +1,34 @@
+// freertos/task_snapshot.h - host build, ESP-IDF task snapshot extension
+
+#pragma	once
+
+#include "freertos/task.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+// ############################################# Structures ########################################
+
+typedef struct xTASK_SNAPSHOT {
+	void * pxTCB;										// task handle
+	StackType_t * pxTopOfStack;
+	StackType_t * pxEndOfStack;
+} TaskSnapshot_t;
+
+// ################################### Public function prototypes ##################################
+
+/**
+ * @brief		list all tasks, as the ESP-IDF kernel extension, provided by esp_host.c
+ * @param[out]	pxTaskSnapshotArray array to be filled
+ * @param[in]	uxArrayLength number of entries in the array
+ * @param[out]	pxTCBSize size of a TCB
+ * @return		number of entries filled in
+ * @note		call with the scheduler suspended
+ */
+UBaseType_t uxTaskGetSnapshotAll(TaskSnapshot_t * const pxTaskSnapshotArray, const UBaseType_t uxArrayLength,
+	UBaseType_t * const pxTCBSize);
+
+#ifdef __cplusplus
+}
+#endif
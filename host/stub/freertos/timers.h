@@ -0,0 +1,6 @@
+// freertos/timers.h - host build, upstream kernel header
+
+#pragma	once
+
+#include "freertos/task.h"
+#include <timers.h>
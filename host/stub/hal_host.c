@@ -0,0 +1,76 @@
+//	hal_host.c - host build, report & console stubs for the rtos-support layer
+
+#include "hal_platform.h"
+#include "FreeRTOS_Support.h"
+#include "hal_stdio.h"
+#include "errors_events.h"
+
+#include <stdarg.h>
+#include <stdio.h>
+#include <string.h>
+
+// ########################################### Macros ##############################################
+
+#define hostFMT_SIZE				512
+
+// ####################################### Global variables ########################################
+
+SemaphoreHandle_t shUARTmux = NULL, shSLvars = NULL, shSLsock = NULL;
+EventGroupHandle_t TaskRunState = NULL, TaskDeleteState = NULL;
+
+static StaticEventGroup_t sRunState, sDeleteState;
+
+// ####################################### Public functions ########################################
+
+int xReport(report_t * psR, const char * pcFmt, ...) {
+	// %C takes the colour attribute on target, xpfCOL() yields "" on the host so print it as %s
+	char caFmt[hostFMT_SIZE];
+	size_t Len = strlen(pcFmt);
+	if (Len < sizeof(caFmt)) {
+		memcpy(caFmt, pcFmt, Len + 1);
+		for (char * pc = caFmt; (pc = strchr(pc, '%')) != NULL; pc += 2) {
+			if (pc[1] == 'C')
+				pc[1] = 's';
+			else if (pc[1] == '\0')
+				break;
+		}
+		pcFmt = caFmt;
+	}
+	va_list vaList;
+	va_start(vaList, pcFmt);
+	int iRV;
+	if (psR && psR->pcBuf) {
+		size_t Free = psR->Size - psR->Used;
+		iRV = vsnprintf(psR->pcBuf + psR->Used, Free, pcFmt, vaList);
+		if (iRV > 0)
+			psR->Used += ((size_t) iRV < Free) ? (size_t) iRV : (Free ? Free - 1 : 0);
+	} else {
+		iRV = vprintf(pcFmt, vaList);
+	}
+	va_end(vaList);
+	return iRV;
+}
+
+void vHostEventInit(void) {
+	TaskRunState = xEventGroupCreateStatic(&sRunState);
+	TaskDeleteState = xEventGroupCreateStatic(&sDeleteState);
+}
+
+void halEventUpdateRunTasks(EventBits_t ebX, bool bSet) {
+	if (bSet)
+		xEventGroupSetBits(TaskRunState, ebX);
+	else
+		xEventGroupClearBits(TaskRunState, ebX);
+}
+
+void halEventUpdateDeleteTasks(EventBits_t ebX, bool bSet) {
+	if (bSet)
+		xEventGroupSetBits(TaskDeleteState, ebX);
+	else
+		xEventGroupClearBits(TaskDeleteState, ebX);
+}
+
+void vHostAssert(const char * pcExpr, const char * pcFile, int Line) {
+	fprintf(stderr, "ASSERT '%s' %s:%d\n", pcExpr, pcFile, Line);
+	abort();
+}
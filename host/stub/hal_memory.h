@@ -0,0 +1,7 @@
+// hal_memory.h - host build stub, all memory is treated as internal SRAM
+
+#pragma	once
+
+#include <stdbool.h>
+
+static inline bool halMemorySRAM(void * pvAddr) { return pvAddr != NULL; }
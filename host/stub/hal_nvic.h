@@ -0,0 +1,7 @@
+// hal_nvic.h - host build stub, the POSIX port has no interrupt context
+
+#pragma	once
+
+#include <stdbool.h>
+
+static inline bool halNVIC_CalledFromISR(void) { return false; }
@@ -0,0 +1,14 @@
+// hal_platform.h - host build stub, application & platform configuration used by rtos-support
+
+#pragma	once
+
+#include "definitions.h"
+
+#define halUSE_BSP					0
+#define cmakeGUI					0
+#define appPRODUCTION				0
+
+#define appFRTLSP_EVT_MASK			1					// thread local storage index of task mask
+#define appFRTLSP_ARENA				2					// thread local storage index of task arena
+#define appFRTLSP_STACK				3					// thread local storage index of stack scan entry
+#define taskCONSOLE_MASK			0x00000001UL
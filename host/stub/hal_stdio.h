@@ -0,0 +1,72 @@
+// hal_stdio.h - host build stub, report control & console output
+
+#pragma	once
+
+#include "definitions.h"
+#include <stdio.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+// ########################################## Macros ###############################################
+
+#define colourFG_RED				31
+#define colourFG_GREEN				32
+#define colourFG_YELLOW				33
+#define colourFG_CYAN				36
+#define attrRESET					0
+#define xpfCOL(c,a)					""					// %C argument, colour codes are dropped
+
+#define fmTST(f)					(psR->sFM.f)
+
+// console output via xReport() like the target's printfx, u32_t formats (%lu) are for unsigned long on target
+#define PX(f, ...)					xReport(NULL, f, ##__VA_ARGS__)
+#define RP(f, ...)					xReport(NULL, f, ##__VA_ARGS__)
+#define IF_PX(t, f, ...)			do { if (t) PX(f, ##__VA_ARGS__); } while (0)
+#define IF_RP(t, f, ...)			do { if (t) RP(f, ##__VA_ARGS__); } while (0)
+#define IF_TRACK(t, f, ...)			IF_RP(t, f, ##__VA_ARGS__)
+
+#define myASSERT(x)					do { if ((x) == 0) vHostAssert(#x, __FILE__, __LINE__); } while (0)
+#define IF_myASSERT(t, x)			do { if (t) myASSERT(x); } while (0)
+
+// ######################################### Structures ############################################
+
+typedef union fm_t {
+	struct {
+		u32_t uCount:24;								// task selection mask, tasks 1->24
+		u32_t bTskNum:1;
+		u32_t bPrioX:1;
+		u32_t bState:1;
+		u32_t bStack:1;
+		u32_t bCore:1;
+		u32_t bXtras:1;
+		u32_t bNL:1;
+		u32_t aNL:1;
+	};
+	u32_t u32Val;
+} fm_t;
+
+/* Output goes to pcBuf (truncated at Size) if provided, else to stdout */
+typedef struct report_t {
+	char * pcBuf;
+	size_t Size;
+	size_t Used;
+	fm_t sFM;
+} report_t;
+
+// ################################### Public function prototypes ##################################
+
+/**
+ * @brief		printf style output to a report buffer or stdout
+ * @param[in]	psR pointer to report control structure, NULL for stdout
+ * @param[in]	pcFmt format string, standard conversions plus %C (colour, printed as empty string)
+ * @return		size of character output generated
+ */
+int xReport(report_t * psR, const char * pcFmt, ...);
+
+void vHostAssert(const char * pcExpr, const char * pcFile, int Line);
+
+#ifdef __cplusplus
+}
+#endif
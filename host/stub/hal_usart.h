@@ -0,0 +1,7 @@
+// hal_usart.h - host build stub
+
+#pragma	once
+
+#include "FreeRTOS_Support.h"
+
+extern SemaphoreHandle_t shUARTmux;
@@ -0,0 +1,5 @@
+// options.h - host build stub, all runtime options read as 0
+
+#pragma	once
+
+#define OPT_GET(x)					0
@@ -0,0 +1,13 @@
+// syslog.h - host build stub, messages go straight to stdout
+
+#pragma	once
+
+#include "FreeRTOS_Support.h"
+#include <stdio.h>
+
+#define SL_ERR(f, ...)				printf("ERR " f "\n", ##__VA_ARGS__)
+#define SL_WAR(f, ...)				printf("WAR " f "\n", ##__VA_ARGS__)
+#define SL_NOT(f, ...)				printf("NOT " f "\n", ##__VA_ARGS__)
+#define SL_INFO(f, ...)				printf("INF " f "\n", ##__VA_ARGS__)
+
+extern SemaphoreHandle_t shSLvars, shSLsock;
@@ -0,0 +1,3 @@
+// systiming.h - host build stub, no timing instrumentation
+
+#pragma	once
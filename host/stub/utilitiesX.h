@@ -0,0 +1,7 @@
+// utilitiesX.h - host build stub
+
+#pragma	once
+
+#include "definitions.h"
+
+static inline u32_t u32RoundUP(u32_t Value, u32_t Multiple) { return ((Value + Multiple - 1) / Multiple) * Multiple; }
@@ -0,0 +1,125 @@
+#!/usr/bin/env python3
+"""Convert an xRtosTraceDump() text dump to Chrome trace / Perfetto JSON.
+
+Usage: rtos_trace2json.py dump.txt [-o trace.json]
+
+Load the output in https://ui.perfetto.dev or chrome://tracing. The "Cores" process has one track
+per core showing which task (or ISR) ran when, the "Tasks" process has one track per task with the
+core it ran on, making preemption, scheduling gaps and core migration visible. Semaphore waits are
+shown as slices on the task tracks.
+"""
+
+import argparse
+import json
+import sys
+
+SWITCH_IN, SWITCH_OUT, ISR_ENTER, ISR_EXIT, TASK_CREATE, TASK_DELETE, SEM_TAKE, SEM_GIVE = range(1, 9)
+PID_CORES, PID_TASKS = 0, 1
+
+
+def parse(lines):
+    """Return (cores, hz, names, records) with records as (core, ticks, type, aux, id) per core."""
+    cores, hz, names, recs, active = 1, 1000000, {}, {}, False
+    for line in lines:
+        line = line.strip()
+        # console output may prefix or interleave the dump, only use lines between the markers
+        if '#RTOSTRACE' in line:
+            f = line[line.index('#RTOSTRACE'):].split()
+            cores, hz, active = int(f[2]), int(f[3]), True
+            continue
+        if not active:
+            continue
+        if line.startswith('#END'):
+            break
+        f = line.split()
+        if len(f) >= 3 and f[0] == 'N':
+            names[int(f[1])] = ' '.join(f[2:])
+        elif len(f) == 6 and f[0] == 'R':
+            core = int(f[1])
+            recs.setdefault(core, []).append([int(f[2]), int(f[3]), int(f[4]), int(f[5])])
+    return cores, hz, names, recs
+
+
+def delta32(t, ref):
+    d = (t - ref) & 0xFFFFFFFF
+    return d - 0x100000000 if d >= 0x80000000 else d
+
+
+def unwrap(recs, ref):
+    """Extend 32 bit timestamps relative to ref (shared by all cores so they stay aligned). Records are
+    kept in write order, small negative steps from nested ISRs are preserved."""
+    base, last = ref, ref
+    for r in recs:
+        base += delta32(r[0], last)
+        last = r[0]
+        r[0] = base
+    return recs
+
+
+def convert(cores, hz, names, recs):
+    ev = [{'ph': 'M', 'pid': PID_CORES, 'name': 'process_name', 'args': {'name': 'Cores'}},
+          {'ph': 'M', 'pid': PID_TASKS, 'name': 'process_name', 'args': {'name': 'Tasks'}}]
+    for c in range(cores):
+        ev.append({'ph': 'M', 'pid': PID_CORES, 'tid': c, 'name': 'thread_name', 'args': {'name': 'Core %d' % c}})
+    for num, name in names.items():
+        ev.append({'ph': 'M', 'pid': PID_TASKS, 'tid': num, 'name': 'thread_name', 'args': {'name': '%s #%d' % (name, num)}})
+
+    ref = recs[min(recs)][0][0]
+    per_core = {c: unwrap(v, ref) for c, v in recs.items()}
+    t0 = min((v[0][0] for v in per_core.values() if v), default=0)
+
+    def us(t):
+        return (t - t0) * 1e6 / hz
+
+    def task(num):
+        return names.get(num, 'task #%d' % num)
+
+    for core, rl in per_core.items():
+        running, t_in, isr_depth, take = None, None, 0, {}
+        for t, typ, aux, ident in rl:
+            if typ == SWITCH_IN:
+                running, t_in = ident, t
+            elif typ == SWITCH_OUT:
+                if running is not None and running == ident:
+                    dur = (t - t_in) * 1e6 / hz
+                    ev.append({'ph': 'X', 'pid': PID_CORES, 'tid': core, 'name': task(ident), 'ts': us(t_in), 'dur': dur})
+                    ev.append({'ph': 'X', 'pid': PID_TASKS, 'tid': ident, 'name': 'Core %d' % core, 'ts': us(t_in), 'dur': dur})
+                running = None
+            elif typ == ISR_ENTER:
+                isr_depth += 1
+                ev.append({'ph': 'B', 'pid': PID_CORES, 'tid': core, 'name': 'ISR %d' % ident, 'ts': us(t)})
+            elif typ == ISR_EXIT:
+                if isr_depth:
+                    isr_depth -= 1
+                    ev.append({'ph': 'E', 'pid': PID_CORES, 'tid': core, 'ts': us(t)})
+            elif typ in (TASK_CREATE, TASK_DELETE):
+                what = 'create' if typ == TASK_CREATE else 'delete'
+                ev.append({'ph': 'i', 's': 'g', 'pid': PID_CORES, 'tid': core, 'name': '%s %s' % (what, task(ident)), 'ts': us(t)})
+            elif typ == SEM_TAKE and running is not None:
+                if aux == 0:
+                    take[(running, ident)] = t
+                elif (running, ident) in take:
+                    ts = take.pop((running, ident))
+                    ev.append({'ph': 'X', 'pid': PID_TASKS, 'tid': running, 'name': 'take sem@%04x' % ident,
+                               'ts': us(ts), 'dur': (t - ts) * 1e6 / hz, 'args': {'result': 'taken' if aux == 1 else 'timeout'}})
+            elif typ == SEM_GIVE:
+                tid, pid = (running, PID_TASKS) if running is not None and aux == 0 else (core, PID_CORES)
+                ev.append({'ph': 'i', 's': 't', 'pid': pid, 'tid': tid, 'name': 'give sem@%04x' % ident, 'ts': us(t)})
+    return {'traceEvents': ev, 'displayTimeUnit': 'ns'}
+
+
+def main():
+    ap = argparse.ArgumentParser(description=__doc__.splitlines()[0])
+    ap.add_argument('dump', help='text captured from xRtosTraceDump(), - for stdin')
+    ap.add_argument('-o', '--output', help='JSON output file, default stdout')
+    a = ap.parse_args()
+    src = sys.stdin if a.dump == '-' else open(a.dump, errors='replace')
+    cores, hz, names, recs = parse(src)
+    if not recs:
+        sys.exit('no #RTOSTRACE records found')
+    out = open(a.output, 'w') if a.output else sys.stdout
+    json.dump(convert(cores, hz, names, recs), out)
+
+
+if __name__ == '__main__':
+    main()